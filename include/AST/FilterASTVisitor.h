@@ -1,7 +1,11 @@
 #pragma once
 
+#include <array>
+#include <tuple>
+
 #include "AST/SourceCode.h"
 #include "Compiler/CompilationUnit.h"
+#include "Support/Ranges.h"
 #include "clang/AST/RecursiveASTVisitor.h"
 
 namespace clice {
@@ -184,4 +188,98 @@ protected:
     bool interested_only;
 };
 
+/// Traverse the AST only once and dispatch every node to multiple visitors, so that
+/// the features which need a whole traversal could be computed together. The visitors
+/// should be `FilteredASTVisitor`s which only implement `Visit*` methods, their own
+/// `Traverse*` methods are never called. Instead of `on_traverse_decl`, a visitor could
+/// implement `on_enter_decl` and `on_leave_decl` to be notified around the children.
+template <typename... Visitors>
+class FusedASTVisitor : public FilteredASTVisitor<FusedASTVisitor<Visitors...>> {
+public:
+    using Base = FilteredASTVisitor<FusedASTVisitor>;
+
+    FusedASTVisitor(CompilationUnit& unit, bool interested_only, Visitors&... visitors) :
+        Base(unit, interested_only), visitors(visitors...) {}
+
+    bool on_traverse_decl(clang::Decl* decl, auto MF) {
+        std::apply(
+            [&](auto&... visitor) {
+                (
+                    [&] {
+                        if constexpr(requires { visitor.on_enter_decl(decl); }) {
+                            visitor.on_enter_decl(decl);
+                        }
+                    }(),
+                    ...);
+            },
+            visitors);
+
+        bool res = (this->*MF)(decl);
+
+        std::apply(
+            [&](auto&... visitor) {
+                (
+                    [&] {
+                        if constexpr(requires { visitor.on_leave_decl(decl); }) {
+                            visitor.on_leave_decl(decl);
+                        }
+                    }(),
+                    ...);
+            },
+            visitors);
+
+        return res;
+    }
+
+    /// `WalkUpFrom*` of each visitor calls all its `Visit*` methods from the most base class
+    /// to the most derived class without traversing children.
+#define FORWARD_WALK_UP(name, type)                                                                \
+    bool WalkUpFrom##name(type node) {                                                             \
+        return dispatch([&](auto& visitor) { return visitor.WalkUpFrom##name(node); });            \
+    }
+
+#define ABSTRACT_DECL(decl)
+#define DECL(name, base) FORWARD_WALK_UP(name##Decl, clang::name##Decl*)
+#include "clang/AST/DeclNodes.inc"
+
+#define ABSTRACT_STMT(stmt)
+#define STMT(name, base) FORWARD_WALK_UP(name, clang::name*)
+#include "clang/AST/StmtNodes.inc"
+
+#define ABSTRACT_TYPE(name, base)
+#define TYPE(name, base) FORWARD_WALK_UP(name##TypeLoc, clang::name##TypeLoc)
+#include "clang/AST/TypeNodes.inc"
+
+#undef FORWARD_WALK_UP
+
+    bool VisitNestedNameSpecifierLoc(clang::NestedNameSpecifierLoc loc) {
+        return dispatch([&](auto& visitor) { return visitor.VisitNestedNameSpecifierLoc(loc); });
+    }
+
+    bool VisitConceptReference(clang::ConceptReference* reference) {
+        return dispatch([&](auto& visitor) { return visitor.VisitConceptReference(reference); });
+    }
+
+private:
+    /// Call `visit` with each visitor which isn't stopped. A visitor is stopped once it
+    /// returns false and isn't called any more, while others continue. The traversal is
+    /// aborted only if all visitors are stopped.
+    bool dispatch(auto&& visit) {
+        [&]<std::size_t... Is>(std::index_sequence<Is...>) {
+            (
+                [&] {
+                    if(!stopped[Is] && !visit(std::get<Is>(visitors))) {
+                        stopped[Is] = true;
+                    }
+                }(),
+                ...);
+        }(std::index_sequence_for<Visitors...>());
+
+        return !ranges::all_of(stopped, [](bool value) { return value; });
+    }
+
+    std::tuple<Visitors&...> visitors;
+    std::array<bool, sizeof...(Visitors)> stopped = {};
+};
+
 }  // namespace clice
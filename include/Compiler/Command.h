@@ -113,6 +113,9 @@ public:
     auto get_command(this Self& self, llvm::StringRef file, CommandOptions options = {})
         -> LookupInfo;
 
+    /// Get all files which have a command in the database.
+    auto files(this Self& self) -> std::vector<llvm::StringRef>;
+
     /// Load compile commands from given directories. If no valid commands are found,
     /// search recursively from the workspace directory.
     auto load_compile_database(this Self& self,
@@ -4,9 +4,11 @@
 #include "Preamble.h"
 #include "CompilationUnit.h"
 #include "Support/FileSystem.h"
+#include "Support/LineTable.h"
 
 namespace clang {
 class CodeCompleteConsumer;
+class CompilerInvocation;
 }
 
 namespace clice {
@@ -34,6 +36,14 @@ struct CompilationParams {
     /// Code completion file:offset.
     std::tuple<std::string, std::uint32_t> completion;
 
+    /// The line table of the completion file. If provided, it is used to compute the
+    /// line and column of completion point instead of scanning the whole buffer.
+    std::shared_ptr<const LineTable> line_table;
+
+    /// A prepared invocation created by `prepare_invocation`. If provided, it is copied
+    /// instead of running the driver to create a new one from `arguments` again.
+    std::shared_ptr<const clang::CompilerInvocation> invocation;
+
     /// The memory buffers for all remapped file.
     llvm::StringMap<std::unique_ptr<llvm::MemoryBuffer>> buffers;
 
@@ -53,10 +63,20 @@ struct CompilationParams {
         }
         buffers.try_emplace(path, llvm::MemoryBuffer::getMemBufferCopy(content));
     }
+
+    /// Like `add_remapped_file` but refer to the content directly without copying it,
+    /// caller should make sure the content is null-terminated and outlives the compilation.
+    void add_remapped_file_ref(llvm::StringRef path, llvm::StringRef content) {
+        buffers.try_emplace(path, llvm::MemoryBuffer::getMemBuffer(content, path));
+    }
 };
 
 using CompilationResult = std::expected<CompilationUnit, std::string>;
 
+/// Run the driver to create an invocation from `params.arguments`, which could be reused by
+/// compilations with the same arguments through `params.invocation`.
+std::shared_ptr<const clang::CompilerInvocation> prepare_invocation(CompilationParams& params);
+
 /// Only preprocess ths source flie.
 CompilationResult preprocess(CompilationParams& params);
 
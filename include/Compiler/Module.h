@@ -2,8 +2,10 @@
 
 #include <string>
 #include <vector>
+#include <optional>
 #include <expected>
 #include "Support/Struct.h"
+#include "llvm/ADT/StringRef.h"
 
 namespace clice {
 
@@ -32,6 +34,9 @@ inherited_struct(PCMInfo, ModuleInfo) {
 
     /// Files involved in building this PCM(not include module).
     std::vector<std::string> deps;
+
+    /// The hash of declarations visible to importers, see `computeInterfaceHash`.
+    std::uint64_t hash = 0;
 };
 
 /// If input file is module interface unit, return its module name.
@@ -42,4 +47,15 @@ std::string scanModuleName(CompilationParams& params);
 /// collect its module name and dependencies.
 std::expected<ModuleInfo, std::string> scanModule(CompilationParams& params);
 
+/// Lex the given content in raw mode to collect its module name and dependencies without
+/// running the preprocessor. If the module declaration or any import occurs in a condition
+/// directive, the result cannot be determined by lexing, return `std::nullopt` and caller
+/// should fall back to `scanModule`.
+std::optional<ModuleInfo> scanModuleDirectives(llvm::StringRef content);
+
+/// Compute the hash of all declarations in the module unit which are visible to importers.
+/// Changes invisible to importers, e.g. the body of non-inline functions, don't change the
+/// hash. So if the hash is unchanged after rebuilding, importers don't need to be rebuilt.
+std::uint64_t computeInterfaceHash(CompilationUnit& unit);
+
 }  // namespace clice
@@ -4,34 +4,14 @@
 #include <cstdint>
 
 #include "AST/SourceCode.h"
+#include "Feature/Options.h"
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/StringRef.h"
 
 namespace clice {
 
 struct CompilationParams;
 
-namespace config {
-
-struct CodeCompletionOption {
-    /// Insert placeholder for keywords? function call parameters? template arguments?
-    bool enable_keyword_snippet = false;
-
-    /// Also apply for lambda ...
-    bool enable_function_arguments_snippet = false;
-    bool enable_template_arguments_snippet = false;
-
-    bool insert_paren_in_function_call = false;
-    /// TODO: Add more detailed option, see
-    /// https://github.com/llvm/llvm-project/issues/63565
-
-    bool bundle_overloads = true;
-
-    /// The limits of code completion, 0 is non limit.
-    std::uint32_t limit = 0;
-};
-
-};  // namespace config
-
 namespace feature {
 
 enum class CompletionItemKind {
@@ -94,12 +74,33 @@ struct CompletionItem {
         /// The source range to be replaced by the new text.
         LocalSourceRange range;
     } edit;
+
+    /// Additional edits applied along with `edit`, e.g. inserting the missing `#include`.
+    std::vector<Edit> additional_edits;
+};
+
+struct CodeCompletionResult {
+    /// The best matched items, at most `limit` of them.
+    std::vector<CompletionItem> items;
+
+    /// Whether some matched items are dropped because of the limit. If so, the client
+    /// should query again instead of filtering the items when typing more characters.
+    bool incomplete = false;
 };
 
-using CodeCompletionResult = std::vector<CompletionItem>;
+CodeCompletionResult code_complete(CompilationParams& params,
+                                   const config::CodeCompletionOption& option);
+
+/// Get the range of the identifier to be completed at the given offset, which
+/// will be replaced by the completion item.
+LocalSourceRange completion_prefix(llvm::StringRef content, std::uint32_t offset);
 
-std::vector<CompletionItem> code_complete(CompilationParams& params,
-                                          const config::CodeCompletionOption& option);
+/// Filter and rescore the items of a previous completion with the prefix at given offset.
+/// The prefix must be an extension of the previous one, so that the previous items are a
+/// superset of current ones, and we don't need to run code completion again.
+std::vector<CompletionItem> filter_completion(llvm::ArrayRef<CompletionItem> items,
+                                              llvm::StringRef content,
+                                              std::uint32_t offset);
 
 }  // namespace feature
 
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "Feature/DocumentLink.h"
+#include "Feature/DocumentSymbol.h"
+#include "Feature/FoldingRange.h"
+#include "Feature/SemanticToken.h"
+
+namespace clice::feature {
+
+/// The features of the interested file which don't depend on the request position,
+/// so they could be computed once after the AST is built.
+struct FileFeatures {
+    SemanticTokens semantic_tokens;
+
+    FoldingRanges folding_ranges;
+
+    DocumentSymbols document_symbols;
+
+    DocumentLinks document_links;
+};
+
+/// Generate all file features for the interested file. Folding ranges and document symbols
+/// are collected in a single traversal of AST.
+FileFeatures file_features(CompilationUnit& unit);
+
+}  // namespace clice::feature
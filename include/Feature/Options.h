@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+
+/// The options of features, they are kept apart from the feature headers so that the server
+/// config could hold them without depending on the features.
+namespace clice::config {
+
+struct CodeCompletionOption {
+    /// Insert placeholder for keywords? function call parameters? template arguments?
+    bool enable_keyword_snippet = false;
+
+    /// Also apply for lambda ...
+    bool enable_function_arguments_snippet = false;
+    bool enable_template_arguments_snippet = false;
+
+    bool insert_paren_in_function_call = false;
+    /// TODO: Add more detailed option, see
+    /// https://github.com/llvm/llvm-project/issues/63565
+
+    bool bundle_overloads = true;
+
+    /// The limits of code completion, 0 is non limit.
+    std::uint32_t limit = 0;
+};
+
+}  // namespace clice::config
@@ -1,13 +1,14 @@
 #pragma once
 
-#include <bitset>
 #include <cstdint>
 #include <deque>
+#include <memory>
 #include <vector>
 
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/SmallVector.h"
 
 namespace clice::index {
 
@@ -35,4 +36,76 @@ struct Contextual {
     }
 };
 
+/// A set of canonical context ids. Most elements occur in only a few contexts, so a small
+/// set is stored as sorted ids and it is switched to a bit vector when it grows large, and
+/// back to sorted ids when it shrinks to half of the limit. The cost of operations is
+/// proportional to the count of ids in the set, or the max id once the set is dense.
+class ContextSet {
+public:
+    ContextSet() = default;
+
+    ContextSet(const ContextSet& other);
+
+    ContextSet(ContextSet&& other) = default;
+
+    ContextSet& operator=(const ContextSet& other);
+
+    ContextSet& operator=(ContextSet&& other) = default;
+
+    bool test(std::uint32_t id) const;
+
+    void set(std::uint32_t id);
+
+    void reset(std::uint32_t id);
+
+    /// The count of ids in the set.
+    std::uint32_t count() const;
+
+    bool none() const {
+        return count() == 0;
+    }
+
+    bool any() const {
+        return !none();
+    }
+
+    /// Intersect with other set, the result is sparse if any of them is sparse.
+    ContextSet& operator&=(const ContextSet& other);
+
+    /// Visit the ids in ascending order until `visitor` returns false.
+    template <typename Visitor>
+    void for_each(const Visitor& visitor) const {
+        if(bits) {
+            for(auto id: bits->set_bits()) {
+                if(!visitor(static_cast<std::uint32_t>(id))) {
+                    return;
+                }
+            }
+        } else {
+            for(auto id: ids) {
+                if(!visitor(id)) {
+                    return;
+                }
+            }
+        }
+    }
+
+private:
+    /// Switch to sparse representation if the dense set has few ids left.
+    void shrink();
+
+private:
+    /// The max count of ids stored sparsely.
+    constexpr inline static std::uint32_t SparseLimit = 32;
+
+    /// The sorted ids if the set is sparse.
+    llvm::SmallVector<std::uint32_t, 2> ids;
+
+    /// The bits if the set is dense.
+    std::unique_ptr<llvm::BitVector> bits;
+
+    /// The count of set bits if the set is dense, so that shrinking is checked cheaply.
+    std::uint32_t dense_count = 0;
+};
+
 }  // namespace clice::index
@@ -1,28 +1,69 @@
 #pragma once
 
+#include <memory>
 #include <vector>
+#include <optional>
 
 #include "Shared.h"
+#include "LazyArray.h"
 #include "Feature/SemanticToken.h"
 #include "Feature/FoldingRange.h"
 #include "Feature/DocumentLink.h"
 #include "Feature/DocumentSymbol.h"
 
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "clang/Basic/SourceLocation.h"
 
 namespace clice::index {
 
+/// Lazy views over the sections of `FeatureIndex`, the fields are read from
+/// the buffer when accessed instead of being deserialized up front.
+struct FoldingRange : Relative {
+    LocalSourceRange range() const;
+
+    feature::FoldingRangeKind kind() const;
+
+    llvm::StringRef text() const;
+};
+
+struct DocumentLink : Relative {
+    LocalSourceRange range() const;
+
+    llvm::StringRef file() const;
+};
+
+struct DocumentSymbol : Relative {
+    LocalSourceRange selectionRange() const;
+
+    LocalSourceRange range() const;
+
+    SymbolKind kind() const;
+
+    llvm::StringRef name() const;
+
+    llvm::StringRef detail() const;
+
+    LazyArray<DocumentSymbol> children() const;
+};
+
 class FeatureIndex {
 public:
     FeatureIndex(char* base, std::size_t size) : base(base), size(size) {}
 
+    /// Map the index file into memory, return nullopt if the file doesn't exist, is broken
+    /// or is written by an incompatible version.
+    static std::optional<FeatureIndex> load(llvm::StringRef file);
+
     /// The path of source file.
     llvm::StringRef path();
 
     /// The content of source file.
     llvm::StringRef content();
 
+    /// The hash of source file content.
+    std::uint64_t hash();
+
     feature::SemanticTokens semanticTokens() const;
 
     feature::FoldingRanges foldingRanges() const;
@@ -31,11 +72,29 @@ public:
 
     feature::DocumentSymbols documentSymbols() const;
 
+    /// Semantic tokens are stored as is, so they are returned without copying.
+    llvm::ArrayRef<feature::SemanticToken> tokens() const;
+
+    /// The semantic tokens which begin in the given range, found by binary search.
+    llvm::ArrayRef<feature::SemanticToken> tokens(LocalSourceRange range) const;
+
+    LazyArray<FoldingRange> foldings() const;
+
+    /// The folding ranges which intersect with the given range.
+    std::vector<FoldingRange> foldings(LocalSourceRange range) const;
+
+    LazyArray<DocumentLink> links() const;
+
+    LazyArray<DocumentSymbol> symbols() const;
+
     static Shared<std::vector<char>> build(CompilationUnit& unit);
 
 public:
     char* base;
     std::size_t size;
+
+    /// The mapped file if the index is loaded from disk, shared by copies.
+    std::shared_ptr<llvm::MemoryBuffer> buffer;
 };
 
 }  // namespace clice::index
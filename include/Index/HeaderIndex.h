@@ -26,15 +26,6 @@ public:
         return max_hctx_id == 1 && erased_hctx_ids.empty();
     }
 
-    auto erased_flag() {
-        Bitmap map;
-        map.set();
-        for(auto cctx_id: erased_cctx_ids) {
-            map.reset(cctx_id);
-        }
-        return map;
-    }
-
     /// Get a new header context id.
     std::uint32_t alloc_hctx_id();
 
@@ -43,7 +34,7 @@ public:
 
     std::uint32_t alloc_dependent_elem_id() {
         auto id = dependent_elem_states.size();
-        dependent_elem_states.emplace_back(false);
+        dependent_elem_states.emplace_back();
         return id;
     }
 
@@ -64,6 +55,10 @@ public:
         std::uint32_t cctx_id;
     };
 
+    /// Remove all header contexts of the file. The erased canonical contexts are cleared
+    /// from the states of all dependent elements in one pass, which is proportional to the
+    /// count of dependent elements rather than the elements in erased contexts, since no
+    /// reverse map is kept. The pass is skipped if no canonical context is erased.
     void remove(this HeaderIndex& self, llvm::StringRef path);
 
     HeaderContext add_context(llvm::StringRef path, std::uint32_t include) {
@@ -105,12 +100,17 @@ public:
     /// referenced by contextual elements.
     llvm::SmallVector<std::uint32_t> cctx_element_refs;
 
-    using Bitmap = std::bitset<64>;  /// use llvm::BitVector?
+    using Bitmap = ContextSet;
+
+    /// The active canonical context ids which no dependent element occurs in, i.e. whose
+    /// `cctx_element_refs` is zero. A merged index without any old dependent element could
+    /// only reuse one of them, so that it doesn't need to check all contexts.
+    Bitmap empty_cctx_ids;
 
     /// A map between dependent element id and its state, for dependent element
-    /// we use bitmap to store states. Each bit in bitmap represents whether
-    /// this element occurs in corresponding canonical context id.
-    llvm::SmallVector<Bitmap> dependent_elem_states;
+    /// we use bitmap to store states. Each id in bitmap represents that this
+    /// element occurs in corresponding canonical context id.
+    std::vector<Bitmap> dependent_elem_states;
 
     /// A map between independent element id and its state, for independent element
     /// we directly store the header context ids that it occurs in.
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "AST/SymbolKind.h"
+#include "AST/SourceCode.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/ADT/SmallVector.h"
+
+namespace clice::index {
+
+/// A fuzzy searchable table of the names of all indexed symbols. Candidates are looked up
+/// by the trigrams of query (or the name prefix if the query is shorter than 3 characters),
+/// and then scored by `FuzzyMatcher`, so that only a small part of names is scored.
+class NameIndex {
+public:
+    struct Symbol {
+        /// The unqualified name of symbol.
+        std::string name;
+
+        /// The qualifier of symbol, e.g. `std::`.
+        std::string scope;
+
+        /// The kind of symbol.
+        SymbolKind kind;
+
+        /// The range of symbol name at its definition, or declaration if not defined.
+        LocalSourceRange range;
+    };
+
+    struct Result {
+        /// The matched symbol.
+        const Symbol* symbol;
+
+        /// The file which declares the symbol.
+        llvm::StringRef file;
+
+        /// The score of fuzzy matching, higher is better.
+        float score;
+    };
+
+    /// Replace all symbols declared in the file with given symbols. If the content
+    /// hash of file is unchanged, nothing happens.
+    void update(llvm::StringRef file, std::uint64_t hash, std::vector<Symbol> symbols);
+
+    /// Remove all symbols declared in the file.
+    void remove(llvm::StringRef file);
+
+    /// Whether the symbols of file with given content hash are already in the index.
+    bool contains(llvm::StringRef file, std::uint64_t hash) const;
+
+    /// Find at most `limit` symbols matching the pattern (0 is non limit), sorted by score.
+    /// The results are invalidated by any modification of the index.
+    std::vector<Result> query(llvm::StringRef pattern, std::size_t limit) const;
+
+    /// The count of alive symbols.
+    std::size_t size() const {
+        return entries.size() - removed;
+    }
+
+private:
+    /// Generate the lookup tokens of a symbol name.
+    static void tokenize(llvm::StringRef name, llvm::SmallVectorImpl<std::uint32_t>& tokens);
+
+    /// Insert the entry into the posting lists of its tokens.
+    void insert(std::uint32_t id);
+
+    /// Rebuild all posting lists without removed entries.
+    void compact();
+
+private:
+    struct Entry {
+        Symbol symbol;
+
+        /// The index of declaring file in `files`.
+        std::uint32_t file;
+
+        bool removed = false;
+
+        /// The character set of name, used to reject candidates before fuzzy matching.
+        std::uint64_t char_set = 0;
+    };
+
+    /// All entries, the removed entries are reclaimed in compaction.
+    std::vector<Entry> entries;
+
+    /// The count of removed entries.
+    std::size_t removed = 0;
+
+    /// All files and their ids.
+    std::vector<std::string> files;
+    llvm::StringMap<std::uint32_t> file_ids;
+
+    /// A map between file id and its content hash when updating.
+    llvm::DenseMap<std::uint32_t, std::uint64_t> file_hashes;
+
+    /// A map between file id and ids of entries declared in it.
+    llvm::DenseMap<std::uint32_t, std::vector<std::uint32_t>> file_entries;
+
+    /// A map between token and sorted ids of entries which have this token.
+    llvm::DenseMap<std::uint32_t, std::vector<std::uint32_t>> postings;
+};
+
+}  // namespace clice::index
@@ -43,6 +43,10 @@ struct Symbol {
     /// The symbol name.
     std::string name;
 
+    /// The qualifier of the symbol, e.g. `std::` for `std::vector`. Inline
+    /// namespaces are omitted.
+    std::string scope;
+
     /// All relations of this symbol.
     llvm::DenseSet<Relation> relations;
 };
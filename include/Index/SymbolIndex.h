@@ -1,5 +1,8 @@
 #pragma once
 
+#include <memory>
+#include <optional>
+
 #include "Shared.h"
 #include "LazyArray.h"
 #include "AST/SymbolID.h"
@@ -7,9 +10,16 @@
 #include "AST/SymbolKind.h"
 #include "AST/RelationKind.h"
 #include "Support/JSON.h"
+#include "llvm/Support/MemoryBuffer.h"
 
 namespace clice::index {
 
+namespace memory {
+
+struct RawIndex;
+
+}
+
 struct Symbol;
 
 struct Relation : Relative {
@@ -22,8 +32,11 @@ struct Relation : Relative {
     /// Return the definition range.
     LocalSourceRange sourceRange() const;
 
-    /// The target symbol.
-    Symbol target() const;
+    /// The hash of target symbol id, only valid for relations between symbols and calls.
+    std::uint64_t target_hash() const;
+
+    /// The target symbol, nullopt if it is not in the same index.
+    std::optional<Symbol> target() const;
 };
 
 struct Symbol : Relative {
@@ -36,6 +49,15 @@ struct Symbol : Relative {
     /// Return the symbol name.
     llvm::StringRef name() const;
 
+    /// Return the qualifier of symbol, e.g. `std::`.
+    llvm::StringRef scope() const;
+
+    /// Whether this symbol is not visible to other translation units.
+    bool is_tu_local() const;
+
+    /// Whether this symbol is defined in function scope.
+    bool is_function_local() const;
+
     /// Return the symbol kind.
     SymbolKind kind() const;
 
@@ -51,16 +73,44 @@ struct Occurrence : Relative {
     Symbol symbol() const;
 };
 
+struct Include : Relative {
+    /// The path of included file.
+    llvm::StringRef path() const;
+
+    /// The content hash of included file when indexing.
+    std::uint64_t hash() const;
+};
+
+/// The symbol index of a single file, i.e. a translation unit or a header in the context
+/// of a translation unit. It is stored in binary format and queried without deserializing,
+/// symbols are sorted by id and occurrences are sorted by range.
 class SymbolIndex {
 public:
     SymbolIndex(const char* data, std::uint32_t size) : data(data), size(size) {}
 
+    /// Map the index file into memory, return nullopt if the file doesn't exist, is broken
+    /// or is written by an incompatible version.
+    static std::optional<SymbolIndex> load(llvm::StringRef file);
+
+    /// Copy the binary index built in memory, so that it is owned like a loaded one.
+    static SymbolIndex from(llvm::ArrayRef<char> buffer);
+
     /// The path of source file.
     llvm::StringRef path() const;
 
     /// The content of source file.
     llvm::StringRef content() const;
 
+    /// The hash of source file content.
+    std::uint64_t hash() const;
+
+    /// The hash of compile arguments, only valid for translation units.
+    std::uint64_t arguments_hash() const;
+
+    /// All files included by the translation unit, empty for headers. Together with the
+    /// content and arguments hash, they decide whether the unit should be indexed again.
+    LazyArray<Include> includes() const;
+
     /// All symbols in the index.
     LazyArray<Symbol> symbols() const;
 
@@ -73,13 +123,35 @@ public:
     /// Locate the symbol with given symbol id.
     std::optional<Symbol> locateSymbol(const SymbolID& id) const;
 
-    static Shared<std::vector<char>> build(CompilationUnit& unit);
+    /// Locate the symbol with given hash of symbol id.
+    std::optional<Symbol> locateSymbol(std::uint64_t hash) const;
+
+    struct Dependencies {
+        /// The hash of compile arguments.
+        std::uint64_t arguments;
+
+        /// The path and content hash of included files.
+        std::vector<std::pair<std::string, std::uint64_t>> includes;
+    };
+
+    /// Collect the dependencies of the translation unit.
+    static Dependencies dependencies(CompilationUnit& unit, std::uint64_t arguments);
+
+    /// Build the binary index from the in-memory index of a file, `dependencies` is
+    /// only recorded for translation units.
+    static std::vector<char> build(const memory::RawIndex& index,
+                                   const Dependencies& dependencies = {});
+
+    static Shared<std::vector<char>> build(CompilationUnit& unit, std::uint64_t arguments = 0);
 
     json::Value toJSON(bool line = true);
 
 private:
     const char* data;
     std::uint32_t size;
+
+    /// The mapped file if the index is loaded from disk, shared by copies.
+    std::shared_ptr<llvm::MemoryBuffer> buffer;
 };
 
 }  // namespace clice::index
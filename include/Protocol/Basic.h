@@ -6,6 +6,8 @@
 #include <cstdint>
 #include <optional>
 
+#include "llvm/Support/JSON.h"
+
 namespace clice::proto {
 
 using integer = std::int32_t;
@@ -27,6 +29,10 @@ struct WorkDoneProgressOptions {
     bool workDoneProgress;
 };
 
+/// A token provided by the client to report progress or partial results,
+/// it is either an integer or a string.
+using ProgressToken = llvm::json::Value;
+
 using URI = string;
 using DocumentUri = string;
 
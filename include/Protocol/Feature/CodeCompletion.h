@@ -34,6 +34,16 @@ struct CompletionOptions {
     CompletionItemCapabilities completionItem;
 };
 
-using CompletionParams = TextDocumentPositionParams;
+struct CompletionParams {
+    /// The text document.
+    TextDocumentIdentifier textDocument;
+
+    /// The position inside the text document.
+    Position position;
+
+    /// An optional token that a server can use to report partial results (e.g.
+    /// streaming) to the client.
+    optional<ProgressToken> partialResultToken;
+};
 
 }  // namespace clice::proto
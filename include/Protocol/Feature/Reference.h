@@ -8,4 +8,23 @@ struct ReferenceClientCapabilities {};
 
 using ReferenceOptions = WorkDoneProgressOptions;
 
+struct ReferenceContext {
+    /// Include the declaration of the current symbol.
+    bool includeDeclaration = false;
+};
+
+struct ReferenceParams {
+    /// The text document.
+    TextDocumentIdentifier textDocument;
+
+    /// The position inside the text document.
+    Position position;
+
+    ReferenceContext context;
+
+    /// An optional token that a server can use to report partial results (e.g.
+    /// streaming) to the client.
+    optional<ProgressToken> partialResultToken;
+};
+
 }  // namespace clice::proto
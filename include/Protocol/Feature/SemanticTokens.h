@@ -22,8 +22,13 @@ struct SemanticTokensOptions {
     /// range of a document.
     bool range = false;
 
+    struct SemanticTokensFullOptions {
+        /// The server supports deltas for full documents.
+        bool delta = false;
+    };
+
     /// Server supports providing semantic tokens for a full document.
-    bool full = true;
+    SemanticTokensFullOptions full;
 };
 
 struct SemanticTokensParams {
@@ -31,6 +36,48 @@ struct SemanticTokensParams {
     TextDocumentIdentifier textDocument;
 };
 
-struct SemanticTokens {};
+struct SemanticTokensDeltaParams {
+    /// The text document.
+    TextDocumentIdentifier textDocument;
+
+    /// The result id of a previous response. The result Id can either point to
+    /// a full response or a delta response depending on what was received last.
+    string previousResultId;
+};
+
+struct SemanticTokensRangeParams {
+    /// The text document.
+    TextDocumentIdentifier textDocument;
+
+    /// The range the semantic tokens are requested for.
+    Range range;
+};
+
+struct SemanticTokens {
+    /// An optional result id. If provided and clients support delta updating
+    /// the client will include the result id in the next semantic token request.
+    optional<string> resultId;
+
+    /// The actual tokens.
+    array<uinteger> data;
+};
+
+struct SemanticTokensEdit {
+    /// The start offset of the edit.
+    uinteger start;
+
+    /// The count of elements to remove.
+    uinteger deleteCount;
+
+    /// The elements to insert.
+    array<uinteger> data;
+};
+
+struct SemanticTokensDelta {
+    optional<string> resultId;
+
+    /// The semantic token edits to transform a previous result into a new result.
+    array<SemanticTokensEdit> edits;
+};
 
 }  // namespace clice::proto
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../Basic.h"
+#include "CallHierarchy.h"
 
 namespace clice::proto {
 
@@ -8,4 +9,15 @@ struct TypeHierarchyClientCapabilities {};
 
 using TypeHierarchyOptions = WorkDoneProgressOptions;
 
+using TypeHierarchyPrepareParams = CallHierarchyPrepareParams;
+
+/// The type hierarchy item has the same fields as the call hierarchy item.
+using TypeHierarchyItem = CallHierarchyItem;
+
+struct TypeHierarchySupertypesParams {
+    TypeHierarchyItem item;
+};
+
+using TypeHierarchySubtypesParams = TypeHierarchySupertypesParams;
+
 }  // namespace clice::proto
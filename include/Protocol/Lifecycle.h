@@ -17,7 +17,11 @@ struct LSPInfo {
     std::string version;
 };
 
-struct WindowCapacities {};
+struct WindowCapacities {
+    /// Whether the client supports server initiated progress using the
+    /// `window/workDoneProgress/create` request.
+    bool workDoneProgress = false;
+};
 
 struct RegularExpressionsClientCapabilities {};
 
@@ -95,19 +99,19 @@ struct ServerCapabilities {
     SignatureHelpOptions signatureHelpProvider;
 
     /// The server provides go to declaration support.
-    /// FIXME: DeclarationOptions declarationProvider;
+    DeclarationOptions declarationProvider;
 
     /// The server provides goto definition support.
-    /// FIXME: DefinitionOptions definitionProvider;
+    DefinitionOptions definitionProvider;
 
     /// The server provides goto type definition support.
     /// FIXME: TypeDefinitionOptions typeDefinitionProvider;
 
     /// The server provides goto implementation support.
-    /// FIXME: ImplementationOptions implementationProvider;
+    ImplementationOptions implementationProvider;
 
     /// The server provides find references support.
-    /// FIXME: ReferenceOptions referencesProvider;
+    ReferenceOptions referencesProvider;
 
     /// The server provides document highlight support.
     /// FIXME: DocumentHighlightOptions documentHighlightProvider;
@@ -155,7 +159,7 @@ struct ServerCapabilities {
     /// FIXME: LinkedEditingRangeOptions linkedEditingRangeProvider;
 
     /// The server provides call hierarchy support.
-    /// FIXME: CallHierarchyOptions callHierarchyProvider;
+    CallHierarchyOptions callHierarchyProvider;
 
     /// The server provides semantic tokens support.
     SemanticTokensOptions semanticTokensProvider;
@@ -164,7 +168,7 @@ struct ServerCapabilities {
     /// FIXME: MonikerOptions monikerProvider;
 
     /// The server provides type hierarchy support.
-    /// FIXME: TypeHierarchyOptions typeHierarchyProvider;
+    TypeHierarchyOptions typeHierarchyProvider;
 
     /// The server provides inline values.
     /// FIXME: InlineValueOptions inlineValueProvider;
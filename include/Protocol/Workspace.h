@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Basic.h"
+#include "Feature/DocumentSymbol.h"
 
 namespace clice::proto {
 
@@ -13,10 +14,41 @@ struct WorkspaceFolder {
     string name;
 };
 
-struct WorkspaceClientCapabilities {};
+struct SemanticTokensWorkspaceClientCapabilities {
+    /// Whether the client implementation supports a refresh request sent from
+    /// the server to the client.
+    bool refreshSupport = false;
+};
+
+struct WorkspaceClientCapabilities {
+    /// Capabilities specific to the semantic token requests scoped to the workspace.
+    SemanticTokensWorkspaceClientCapabilities semanticTokens;
+};
 
 struct WorkspaceSymbolOptions {};
 
+struct WorkspaceSymbolParams {
+    /// A query string to filter symbols by. Clients may send an empty
+    /// string here to request all symbols.
+    string query;
+};
+
+/// Represents information about programming constructs like variables, classes,
+/// interfaces etc.
+struct SymbolInformation {
+    /// The name of this symbol.
+    string name;
+
+    /// The kind of this symbol.
+    SymbolKind kind;
+
+    /// The location of this symbol.
+    Location location;
+
+    /// The name of the symbol containing this symbol.
+    string containerName;
+};
+
 struct WorkspaceFoldersServerCapabilities {
     /// The server has support for workspace folders.
     bool supported = true;
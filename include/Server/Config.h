@@ -3,6 +3,7 @@
 #include <vector>
 #include <expected>
 
+#include "Feature/Options.h"
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/StringRef.h"
 
@@ -24,6 +25,38 @@ struct ProjectOptions {
     std::vector<std::string> compile_commands_dirs = {"${workspace}/build"};
 };
 
+struct FeatureOptions {
+    /// Compute the features which don't depend on the request position (semantic tokens,
+    /// folding ranges, document symbols and document links) right after building AST.
+    bool precompute = true;
+
+    /// Ask the client to refresh semantic tokens after they are precomputed.
+    bool refresh = false;
+};
+
+struct IndexOptions {
+    /// Index all files in the compilation database in background after initialized.
+    bool background = true;
+
+    /// The max count of files indexed at the same time, 0 means half of the hardware
+    /// threads, so that the editor and other programs still get enough CPU. It only bounds
+    /// the count, the priority of indexing threads is not lowered.
+    std::size_t concurrency = 0;
+
+    /// Background indexing is paused when the client sends a message, and resumed if no
+    /// message comes for the duration (in milliseconds). It is checked before indexing each
+    /// file, the files being indexed are not interrupted.
+    std::size_t idle_delay = 1000;
+
+    /// An opened file is indexed after its AST is built and no change comes for the duration
+    /// (in milliseconds), so that typing doesn't index every intermediate version.
+    std::size_t edit_delay = 1000;
+
+    /// Header indices from different translation units are merged in background when
+    /// the count of unmerged ones reaches the threshold.
+    std::size_t merge_threshold = 64;
+};
+
 struct Rule {
     /// All patterns of the rule.
     llvm::SmallVector<std::string> patterns;
@@ -42,6 +75,15 @@ struct Config {
     /// Project level configs.
     ProjectOptions project;
 
+    /// Code completion configs.
+    CodeCompletionOption completion = {.limit = 100};
+
+    /// The configs of features computed from AST.
+    FeatureOptions feature;
+
+    /// The configs of background indexing.
+    IndexOptions index;
+
     /// All rules used for specific files.
     llvm::SmallVector<Rule> rules;
 
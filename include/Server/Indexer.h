@@ -1,13 +1,19 @@
 #pragma once
 
 #include <vector>
+#include <chrono>
 #include "Async/Async.h"
 #include "AST/SymbolID.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/StringMap.h"
+#include "llvm/Support/Chrono.h"
 #include "Compiler/Command.h"
+#include "Config.h"
 #include "Index/Index.h"
+#include "Index/NameIndex.h"
+#include "Index/FeatureIndex.h"
+#include "Index/SymbolIndex.h"
 
 namespace clice {
 
@@ -19,15 +25,47 @@ public:
     /// and PCH is used for it.
     async::Task<> index(CompilationUnit& unit);
 
-    /// Index an static file.
-    async::Task<> index(llvm::StringRef file);
+    /// Index a file which is not opened with the PCMs of its imported modules. It is
+    /// compiled without PCH, the preamble is only parsed once for indexing anyway.
+    async::Task<> index(llvm::StringRef file, llvm::StringMap<std::string> pcms);
+
+    /// Whether the file should be indexed again, i.e. its stored shard is missing, or its
+    /// content, arguments or any included file is changed since indexing. If not, the
+    /// stored shards are reused. The files are read in the thread pool.
+    async::Task<bool> need_index(llvm::StringRef file);
+
+    /// Called when the client sends a message. Background indexing is paused until
+    /// no message comes for `index.idle_delay`, so that it doesn't slow down editing.
+    void pause_background() {
+        last_active = std::chrono::steady_clock::now();
+    }
+
+    /// Wait until background indexing is allowed to continue, it is called before
+    /// indexing each file.
+    async::Task<> wait_for_idle();
+
+    /// The max count of files indexed in background at the same time.
+    std::size_t background_concurrency();
+
+    /// Update the name index with the symbols declared in headers of the indices.
+    void update_names(const index::memory::Indices& indices);
+
+    /// Load the stored feature index of the file, return nullopt if the file is not
+    /// indexed or its content is changed since indexing.
+    std::optional<index::FeatureIndex> load_features(llvm::StringRef path,
+                                                     llvm::StringRef content);
+
+    /// Load the stored symbol index of the file, return nullopt if the file is not indexed.
+    /// Check `hash()` of the result to know whether the content is changed since indexing.
+    std::optional<index::SymbolIndex> load_symbols(llvm::StringRef path);
 
     using Path = std::string;
     using PathID = std::uint32_t;
     using SymbolID = std::uint64_t;
 
 public:
-    Indexer(CompilationDatabase& database) : database(database) {}
+    Indexer(CompilationDatabase& database, config::Config& config) :
+        database(database), config(config) {}
 
     PathID getPath(llvm::StringRef path) {
         auto it = paths.find(path);
@@ -41,11 +79,86 @@ public:
         return id;
     }
 
+    /// The names of all symbols declared in indexed headers.
+    const index::NameIndex& name_index() const {
+        return names;
+    }
+
+    /// The count of raw header indices waiting to be merged.
+    std::uint32_t unmerged_indices() const {
+        return unmerged_count;
+    }
+
+    /// The count of raw indices of the header waiting to be merged.
+    std::uint32_t unmerged_indices(llvm::StringRef header);
+
+    /// The merged in-memory index of the header, null if it is not merged yet.
+    const index::memory::HeaderIndex* merged_index(llvm::StringRef header);
+
+    /// Load the stored symbol indices of all files which may contain the symbol, the
+    /// indices of other files are never loaded.
+    ///
+    /// Note that a header shard is only written when the header content changes, so it
+    /// holds the occurrences of one header context, i.e. the macros defined by the first
+    /// translation unit indexing that content. The occurrences which only exist with
+    /// other contexts are missing from the results.
+    ///
+    /// The indices are loaded on the thread pool.
+    async::Task<std::vector<index::SymbolIndex>> find_indices(std::uint64_t symbol);
+
+    /// Search the symbols declared in all indexed files by fuzzy matching their names,
+    /// return at most `limit` results sorted by score.
+    ///
+    /// The name tables are not persisted. After a restart they are filled again from the
+    /// stored shards while background indexing checks each file (see `reuse_shards`), so
+    /// files not checked yet are missing from the results.
+    std::vector<index::NameIndex::Result> search_symbols(llvm::StringRef query,
+                                                         std::size_t limit);
+
+private:
+    /// The path of stored feature index of the file.
+    std::string feature_index_path(llvm::StringRef path);
+
+    /// Write the feature indices of all files in the unit to the index directory,
+    /// files whose stored index is up to date are skipped.
+    void save_features(CompilationUnit& unit);
+
+    /// The path of stored symbol index of the file.
+    std::string symbol_index_path(llvm::StringRef path);
+
+    /// Write the symbol indices of the translation unit and its headers to the index
+    /// directory, headers whose stored index is up to date are skipped.
+    void save_symbols(const index::memory::Indices& indices,
+                      const index::SymbolIndex::Dependencies& dependencies);
+
+    /// The hash of compile arguments of the file in compilation database.
+    std::uint64_t arguments_hash(llvm::StringRef file);
+
+    /// Record that the symbols of the index occur in the file, so that the stored index
+    /// of file is found by `find_indices`.
+    void add_symbols(PathID file, const index::memory::RawIndex& index);
+
+    void add_symbols(PathID file, const index::SymbolIndex& index);
+
+    /// Merge the unmerged header indices in background if their count reaches the
+    /// threshold. Only one merge runs at the same time.
+    void schedule_merge();
+
+    /// Fold the unmerged header indices into the merged ones, so that the memory scales
+    /// with the unique header contents rather than the count of translation units. The
+    /// headers are merged in parallel and the results are published together.
+    async::Task<> merge();
+
+    /// Register the stored shards of the unit and its headers as if they were just indexed,
+    /// the shards of headers not added yet are loaded in the thread pool.
+    async::Task<> reuse_shards(llvm::StringRef file, const index::SymbolIndex& index);
+
 private:
     struct HeaderIndices {
         using RawIndex = std::pair<std::uint32_t, std::unique_ptr<index::memory::RawIndex>>;
 
-        /// The merged index.
+        /// The merged index, only modified by `merge`. It is null while the header is
+        /// being merged.
         std::unique_ptr<index::memory::HeaderIndex> merged;
 
         llvm::DenseMap<PathID, std::vector<RawIndex>> unmergeds;
@@ -53,6 +166,8 @@ private:
 
     CompilationDatabase& database;
 
+    config::Config& config;
+
     /// All paths of indices.
     std::vector<Path> path_storage;
 
@@ -62,16 +177,37 @@ private:
     /// A map between symbol id and files that contains it.
     llvm::DenseMap<SymbolID, llvm::DenseSet<PathID>> symbol_indices;
 
-    /// A map between source file path and its static indices.
+    /// A map between file and its content hash when its symbols are added.
+    llvm::DenseMap<PathID, std::uint64_t> symbol_hashes;
+
+    /// A map between source file path and the path of its stored symbol index.
     llvm::DenseMap<PathID, Path> static_indices;
 
+    /// The count of raw header indices in all `unmergeds`.
     std::uint32_t unmerged_count = 0;
 
+    /// The running background merge.
+    async::Task<> merge_task;
+
+    /// The cached content hashes of files with their modification time, only accessed
+    /// in the main thread by `need_index`.
+    llvm::StringMap<std::pair<llvm::sys::TimePoint<>, std::uint64_t>> content_hashes;
+
+    /// The time when the client sent the last message.
+    std::chrono::steady_clock::time_point last_active;
+
     /// In-memory header indices.
     llvm::DenseMap<PathID, std::unique_ptr<HeaderIndices>> dynamic_header_indices;
 
     /// In-memory translation unit indices.
     llvm::DenseMap<PathID, std::unique_ptr<index::memory::TUIndex>> dynamic_tu_indices;
+
+    /// The names of symbols which could be referenced by other files.
+    index::NameIndex names;
+
+    /// The names of symbols declared in translation units, they are not referenced by
+    /// other files, but are searched in workspace.
+    index::NameIndex sources;
 };
 
 }  // namespace clice
@@ -0,0 +1,153 @@
+#pragma once
+
+#include "Config.h"
+#include "Async/Async.h"
+#include "Compiler/Module.h"
+#include "Compiler/Command.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringSet.h"
+
+namespace clice {
+
+/// The dependency graph of all C++20 named modules in the project. It scans all files
+/// in the compilation database to collect module declarations and imports, and builds
+/// PCMs in topological order on demand, so that files importing modules can be compiled.
+class ModuleGraph {
+public:
+    struct ModuleUnit {
+        /// The source file which declares this module.
+        std::string path;
+
+        /// The name and direct dependencies of this module.
+        ModuleInfo info;
+
+        /// The built PCM of this module, empty if not built yet.
+        std::optional<PCMInfo> pcm;
+
+        /// The modules which import this module directly.
+        std::vector<std::string> dependents;
+
+        /// Whether this module is in an import cycle, such module can never be built.
+        bool cyclic = false;
+
+        /// The files involved in the PCM are changed, the PCM must be rebuilt.
+        bool dirty = false;
+
+        /// Some dependencies are changed, the PCM needs to be rebuilt only if
+        /// the interface of any dependency is changed.
+        bool stale = false;
+
+        /// Increased whenever the interface of this module is changed or its PCM becomes
+        /// unavailable. Comparing versions rather than resetting a flag keeps concurrent
+        /// updates from clearing the changes observed by each other.
+        std::uint64_t version = 0;
+
+        /// The versions of dependencies when the PCM was built, the PCM is still valid if
+        /// none of them is changed since then.
+        llvm::StringMap<std::uint64_t> built_versions;
+
+        /// Whether the PCM of this module is building now.
+        bool building = false;
+
+        /// Notified when the building of PCM is finished.
+        async::Event built_event;
+    };
+
+    /// The scanning result of a file. It is cached on disk, so that only
+    /// modified files need to be scanned again at startup.
+    struct ScanResult {
+        /// The module name and dependencies of this file.
+        ModuleInfo info;
+
+        /// The hash of file content.
+        std::uint64_t hash = 0;
+
+        /// The last modification time of file when scanning.
+        std::int64_t mtime = 0;
+
+        /// The hash of compile arguments if the result comes from preprocessing, which
+        /// depends on the macros and include paths. Zero if it comes from lexing.
+        std::uint64_t arguments = 0;
+    };
+
+    ModuleGraph(CompilationDatabase& database, config::Config& config) :
+        database(database), config(config) {}
+
+    /// Load the cached scanning results from the cache directory.
+    void load();
+
+    /// Save the scanning results to the cache directory.
+    void save();
+
+    /// Scan all files in the compilation database in parallel and rebuild the graph.
+    async::Task<> scan();
+
+    /// Update the modules affected by the change of given file. Only the transitive dependents
+    /// of the changed modules are rebuilt, and the propagation stops at the module whose
+    /// interface hash is unchanged. Return the modules whose interface are changed.
+    async::Task<std::vector<std::string>> update(std::string path);
+
+    /// Build the PCM of given module and all its dependencies. Independent dependencies
+    /// are built in parallel. Return false if any of them fails to build.
+    async::Task<bool> build(std::string name);
+
+    /// Build all modules imported by given file content, and fill the PCMs of them (including
+    /// transitive dependencies) into `pcms` so that the file could be compiled with them.
+    async::Task<bool> resolve(std::string path,
+                              std::string content,
+                              llvm::StringMap<std::string>& pcms);
+
+    /// Same as above, but for a file in the compilation database which is not opened, the
+    /// cached scanning result is used if the file is not modified since scanning.
+    async::Task<bool> resolve(std::string path, llvm::StringMap<std::string>& pcms);
+
+    /// Get the scanning result of given file, return nullptr if not scanned.
+    const ScanResult* scan_result(llvm::StringRef file) const {
+        auto it = scan_results.find(file);
+        return it == scan_results.end() ? nullptr : &it->second;
+    }
+
+    /// Get the module unit with given name, return nullptr if not found.
+    ModuleUnit* get(llvm::StringRef name) {
+        auto it = units.find(name);
+        return it == units.end() ? nullptr : it->second.get();
+    }
+
+private:
+    /// Scan the module info of given file, reuse the cached result if it is not changed.
+    async::Task<std::optional<ScanResult>> scan_file(std::string file);
+
+    /// Find all modules in import cycles and mark them.
+    void check_cycles();
+
+    /// Compute the reverse dependencies of all modules.
+    void compute_dependents();
+
+    /// Build all given modules in parallel, return false if any of them fails.
+    async::Task<bool> build_all(std::vector<std::string> names);
+
+    /// Collect the PCMs of given module and its transitive dependencies.
+    void collect_pcms(llvm::StringRef name, llvm::StringMap<std::string>& pcms);
+
+private:
+    CompilationDatabase& database;
+
+    config::Config& config;
+
+    /// Whether the graph has been scanned, waiters on `scanned_event` are
+    /// resumed when scanning is finished.
+    bool scanned = false;
+    async::Event scanned_event;
+
+    /// A map between file path and its scanning result.
+    llvm::StringMap<ScanResult> scan_results;
+
+    /// A map between file path and the modules whose PCM is built from it.
+    llvm::StringMap<llvm::StringSet<>> file_dependents;
+
+    /// A map between module name and its unit. Only units which could be imported,
+    /// i.e. interface units and partitions, are recorded.
+    llvm::StringMap<std::unique_ptr<ModuleUnit>> units;
+};
+
+}  // namespace clice
@@ -3,15 +3,98 @@
 #include "Config.h"
 #include "Convert.h"
 #include "Indexer.h"
+#include "ModuleGraph.h"
 #include "Async/Async.h"
 #include "Compiler/Command.h"
+#include "Compiler/Compilation.h"
 #include "Compiler/Preamble.h"
 #include "Compiler/Diagnostic.h"
 #include "Feature/DocumentLink.h"
+#include "Feature/FileFeatures.h"
+#include "Feature/CodeCompletion.h"
 #include "Protocol/Protocol.h"
 
 namespace clice {
 
+/// The states shared by all completion requests (code completion and signature help)
+/// of an opening file, so that repeated triggers only pay for the Sema work.
+struct CompletionSession {
+    /// The file version this session is prepared for.
+    std::uint32_t version = 0;
+
+    /// The immutable snapshot of file content, remapped without copying.
+    std::shared_ptr<const std::string> content;
+
+    /// The line table of `content`.
+    std::shared_ptr<const LineTable> lines;
+
+    /// The arguments and the invocation prepared from them, the invocation is
+    /// reused across versions as long as the arguments are unchanged.
+    std::vector<const char*> arguments;
+    std::shared_ptr<const clang::CompilerInvocation> invocation;
+
+    /// The PCH (path, bound) and its build time.
+    std::pair<std::string, std::uint32_t> pch;
+    std::int64_t pch_mtime = 0;
+
+    /// The PCMs of imported modules.
+    llvm::StringMap<std::string> pcms;
+};
+
+/// The result of last code completion, reused if user continues typing the same identifier.
+struct CompletionCache {
+    /// The start offset of the completed identifier.
+    std::uint32_t start = 0;
+
+    /// The offset of completion point.
+    std::uint32_t offset = 0;
+
+    /// The file content and the PCH build time when completing.
+    std::shared_ptr<const std::string> content;
+    std::int64_t pch_mtime = 0;
+
+    /// All candidates matching the prefix at that time.
+    std::vector<feature::CompletionItem> items;
+};
+
+/// The position independent features of current AST, they are computed at once when any
+/// of them is requested, and dropped when the AST is rebuilt.
+struct FeatureCache {
+    /// The AST which the features are computed from, it is null if the features are
+    /// loaded from the stored index before the AST is built.
+    std::shared_ptr<CompilationUnit> ast;
+
+    /// The stored index which the features are loaded from.
+    std::optional<index::FeatureIndex> index;
+
+    /// The content which the features are computed from, owned by `ast` or `index`.
+    llvm::StringRef content;
+
+    /// The line table of `content`, shared by all position conversions of the features.
+    std::shared_ptr<const LineTable> lines;
+
+    feature::FileFeatures features;
+};
+
+/// The encoded semantic tokens of current AST, so that unchanged AST needn't be
+/// visited again and the delta could be computed against the reported ones.
+struct SemanticTokensCache {
+    /// The features which the tokens are encoded from.
+    std::weak_ptr<FeatureCache> features;
+
+    /// The result id of tokens, increased when the tokens are recomputed.
+    std::uint32_t id = 0;
+
+    /// The encoded tokens, shared so that a request could hold the old one
+    /// while it is replaced.
+    std::shared_ptr<const std::vector<proto::uinteger>> data;
+
+    /// The tokens last reported to the client and their result id. The tokens may be
+    /// recomputed eagerly without any request, the delta is computed against these.
+    std::uint32_t reported_id = 0;
+    std::shared_ptr<const std::vector<proto::uinteger>> reported;
+};
+
 struct OpenFile {
     /// The file version, every edition will increase it.
     std::uint32_t version = 0;
@@ -30,6 +113,25 @@ struct OpenFile {
     async::Task<> ast_build_task;
     async::Lock ast_built_lock;
 
+    /// All modules imported by this file, including transitive ones.
+    std::vector<std::string> modules;
+
+    /// The session reused by completion requests.
+    std::shared_ptr<CompletionSession> completion_session;
+
+    /// The result of last code completion.
+    std::shared_ptr<CompletionCache> completion_cache;
+
+    /// The features computed from current AST.
+    std::shared_ptr<FeatureCache> features;
+
+    /// The symbol index built from current AST, only for lookup requests when the stored
+    /// index is outdated. It is dropped when the content is changed, see `Server::get_symbols`.
+    std::optional<index::SymbolIndex> symbols;
+
+    /// The result of last semantic tokens request.
+    SemanticTokensCache semantic_tokens;
+
     /// Collect all diagnostics in the compilation.
     std::shared_ptr<std::vector<Diagnostic>> diagnostics =
         std::make_unique<std::vector<Diagnostic>>();
@@ -171,6 +273,10 @@ private:
 
     async::Task<> on_exit(proto::ExitParams params);
 
+    /// Index all files in the compilation database in background, the progress is
+    /// reported if the client supports server initiated progress.
+    async::Task<> index_workspace();
+
 private:
     /// Load the cache info from disk.
     void load_cache_info();
@@ -184,6 +290,18 @@ private:
 
     async::Task<std::shared_ptr<OpenFile>> add_document(std::string path, std::string content);
 
+    /// Get the completion session of the file, create a new one if the file is changed.
+    async::Task<std::shared_ptr<CompletionSession>> get_completion_session(
+        std::string path,
+        std::shared_ptr<OpenFile> file);
+
+    /// Report the completion results. If the client provides a partial result token, Sema
+    /// results are reported first and then index results, both with `$/progress`, and the
+    /// response is empty as LSP requires. Otherwise they are merged into one response.
+    async::Task<json::Value> report_completion(std::optional<json::Value> token,
+                                               json::Value sema,
+                                               json::Array index);
+
 private:
     async::Task<> on_did_open(proto::DidOpenTextDocumentParams params);
 
@@ -212,10 +330,79 @@ private:
 
     auto on_folding_range(proto::FoldingRangeParams params) -> Result;
 
+    /// Get the features of current AST, compute them in one pass if not cached. Before
+    /// the first AST is built, they are loaded from the stored index if the content is
+    /// unchanged. Return nullptr if neither is available.
+    async::Task<std::shared_ptr<FeatureCache>> get_features(std::string path,
+                                                            std::shared_ptr<OpenFile> file);
+
+    /// Compute the semantic tokens of the file into its cache, they are reused if the
+    /// features are unchanged. Return false if the features are not available.
+    async::Task<bool> update_semantic_tokens(std::string path, std::shared_ptr<OpenFile> file);
+
     auto on_semantic_token(proto::SemanticTokensParams params) -> Result;
 
+    auto on_semantic_token_delta(proto::SemanticTokensDeltaParams params) -> Result;
+
+    auto on_semantic_token_range(proto::SemanticTokensRangeParams params) -> Result;
+
     auto on_inlay_hint(proto::InlayHintParams params) -> Result;
 
+    auto on_workspace_symbol(proto::WorkspaceSymbolParams params) -> Result;
+
+    /// Get the symbol index of the file whose offsets are consistent with its current content.
+    /// For an opened file, the stored index is used only if it is built from the same content,
+    /// otherwise the index is built from current AST. Return nullopt if neither is available.
+    async::Task<std::optional<index::SymbolIndex>> get_symbols(std::string path);
+
+    /// Find the symbol indices of all files containing the symbol, opened files are resolved
+    /// by `get_symbols` and skipped if their index is unavailable. `current` is the index of
+    /// the requested file, it is included even if the stored one doesn't contain the symbol.
+    async::Task<std::vector<index::SymbolIndex>> find_indices(
+        std::uint64_t hash,
+        const index::SymbolIndex* current = nullptr);
+
+    /// Find the locations of relations with given kinds of the symbols at the position in
+    /// all indexed files. Only the symbol indices are used, nothing is compiled. If
+    /// `implementation` is true, the definitions of the implementations are found instead.
+    async::Task<json::Value> lookup(std::string path,
+                                    proto::Position position,
+                                    RelationKind kinds,
+                                    std::optional<json::Value> token,
+                                    bool implementation = false);
+
+    auto on_definition(proto::DefinitionParams params) -> Result;
+
+    auto on_declaration(proto::DeclarationParams params) -> Result;
+
+    auto on_implementation(proto::ImplementationParams params) -> Result;
+
+    auto on_references(proto::ReferenceParams params) -> Result;
+
+    /// Resolve the hierarchy items of the symbols at the position from the symbol indices,
+    /// they are classes if `types` is true, otherwise functions.
+    async::Task<json::Value> prepare_hierarchy(std::string path,
+                                               proto::Position position,
+                                               bool types);
+
+    /// Find the callers or callees of the symbol whose hash is stored in `data`.
+    async::Task<json::Value> hierarchy_calls(std::string data, bool incoming);
+
+    /// Find the base or derived classes of the symbol whose hash is stored in `data`.
+    async::Task<json::Value> hierarchy_types(std::string data, bool supertypes);
+
+    auto on_prepare_call_hierarchy(proto::CallHierarchyPrepareParams params) -> Result;
+
+    auto on_incoming_calls(proto::CallHierarchyIncomingCallsParams params) -> Result;
+
+    auto on_outgoing_calls(proto::CallHierarchyOutgoingCallsParams params) -> Result;
+
+    auto on_prepare_type_hierarchy(proto::TypeHierarchyPrepareParams params) -> Result;
+
+    auto on_supertypes(proto::TypeHierarchySupertypesParams params) -> Result;
+
+    auto on_subtypes(proto::TypeHierarchySubtypesParams params) -> Result;
+
 private:
     /// The current request id.
     std::uint32_t server_request_id = 0;
@@ -226,6 +413,12 @@ private:
 
     PositionEncodingKind kind;
 
+    /// Whether the client supports `workspace/semanticTokens/refresh`.
+    bool semantic_tokens_refresh = false;
+
+    /// Whether the client supports `window/workDoneProgress/create`.
+    bool work_done_progress = false;
+
     std::string workspace;
 
     /// The compilation database.
@@ -237,6 +430,15 @@ private:
     PathMapping mapping;
 
     config::Config config;
+
+    /// The dependency graph of all modules in the project.
+    ModuleGraph module_graph{database, config};
+
+    /// The index of all indexed files.
+    Indexer indexer{database, config};
+
+    /// The task of background indexing.
+    async::Task<> indexing_task;
 };
 
 }  // namespace clice
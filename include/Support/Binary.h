@@ -309,4 +309,39 @@ Object deserialize(Proxy<Object> proxy) {
     }
 }
 
+/// Check whether all strings and arrays referred by the object are inside the binary data
+/// of `size` bytes. A broken or truncated file must be checked before accessing through
+/// `Proxy`, which never checks the offsets.
+template <typename Object>
+bool validate(Proxy<Object> proxy, std::size_t size) {
+    if constexpr(is_directly_binarizable_v<Object>) {
+        return true;
+    } else if constexpr(std::is_same_v<Object, std::string>) {
+        /// Strings are always terminated with `\0`.
+        auto [offset, length] = proxy.value();
+        return std::uint64_t(offset) + length < size;
+    } else if constexpr(is_specialization_of<Object, std::vector>) {
+        using V = typename Object::value_type;
+        auto [offset, length] = proxy.value();
+        if(std::uint64_t(offset) + std::uint64_t(length) * sizeof(binarify_t<V>) > size) {
+            return false;
+        }
+
+        if constexpr(!is_directly_binarizable_v<V>) {
+            for(std::size_t i = 0; i < length; ++i) {
+                if(!validate(proxy[i], size)) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    } else if constexpr(refl::reflectable_struct<Object>) {
+        return [&]<std::size_t... Is>(std::index_sequence<Is...>) {
+            return (validate(proxy.template get<Is>(), size) && ...);
+        }(std::make_index_sequence<refl::member_count<Object>()>());
+    } else {
+        static_assert(dependent_false<Object>, "");
+    }
+}
+
 }  // namespace clice::binary
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <optional>
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/SmallString.h"
@@ -63,6 +64,21 @@ public:
     // Characters beyond MaxWord are ignored.
     std::optional<float> match(llvm::StringRef Word);
 
+    // Compute the case-folded character set of a word. Callers which match the
+    // same words repeatedly could cache it, see may_match().
+    //
+    // The set is a plain 64-bit mask, so checking it is a single AND and needs no
+    // vectorization. It only pays off when cached, e.g. by NameIndex: computing it
+    // costs a pass over the word, like the lowercasing and subsequence check which
+    // match() already does first (with SSE2 where available).
+    static std::uint64_t char_set(llvm::StringRef Word);
+
+    // Whether a word with the character set may match the pattern, i.e. it contains
+    // every pattern character. It's much cheaper than match() and has no false negative.
+    bool may_match(std::uint64_t WordSet) const {
+        return (pat_set & ~WordSet) == 0;
+    }
+
     llvm::StringRef pattern() const {
         return llvm::StringRef(Pat, pat_n);
     }
@@ -99,6 +115,7 @@ private:
     char low_pat[MaxPat];       // Pattern in lowercase
     CharRole pat_role[MaxPat];  // Pattern segmentation info
     CharTypeSet pat_type_set;   // Bitmask of 1<<CharType for all Pattern characters
+    std::uint64_t pat_set;      // Case-folded character set of Pattern, see char_set()
     float score_scale;          // Normalizes scores for the pattern length.
 
     // Word data is initialized on each call to match(), mostly by init().
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <vector>
+#include <cassert>
+#include <cstdint>
+#include <utility>
+#include "llvm/ADT/bit.h"
+#include "llvm/ADT/StringRef.h"
+
+namespace clice {
+
+enum class PositionEncodingKind {
+    UTF8,
+    UTF16,
+    UTF32,
+};
+
+/// @brief Iterates over Unicode codepoints in a UTF-8 encoded string and invokes a callback for
+/// each codepoint.
+///
+/// Processes the input UTF-8 string, calculating the length of each Unicode codepoint in both
+/// UTF-8 (bytes) and UTF-16 (code units), and passes these lengths to the callback.
+/// Iteration stops early if the callback returns `false`.
+///
+/// ASCII characters are treated as 1-byte UTF-8 codepoints with a UTF-16 length of 1.
+/// Non-ASCII characters are processed based on their leading byte to determine UTF-8 length:
+/// - Valid lengths are 2 to 4 bytes.
+/// - Astral codepoints (UTF-8 length of 4) have a UTF-16 length of 2 code units.
+/// Invalid UTF-8 sequences are treated as single-byte ASCII characters.
+///
+/// Returns `false` if the callback stops the iteration.
+template <typename Callback>
+bool iterateCodepoints(llvm::StringRef content, const Callback& callback) {
+    // Iterate over the input string, processing each codepoint.
+    for(size_t index = 0; index < content.size();) {
+        unsigned char c = static_cast<unsigned char>(content[index]);
+
+        // Handle ASCII characters (1-byte UTF-8, 1-code-unit UTF-16).
+        if(!(c & 0x80)) [[likely]] {
+            if(!callback(1, 1)) {
+                return true;
+            }
+
+            ++index;
+            continue;
+        }
+
+        // Determine the length of the codepoint in UTF-8 by counting the leading 1s.
+        size_t length = llvm::countl_one(c);
+
+        // Validate UTF-8 encoding: length must be between 2 and 4.
+        if(length < 2 || length > 4) [[unlikely]] {
+            assert(false && "Invalid UTF-8 sequence");
+
+            // Treat the byte as an ASCII character.
+            if(!callback(1, 1)) {
+                return true;
+            }
+
+            ++index;
+            continue;
+        }
+
+        // Advance the index by the length of the current UTF-8 codepoint.
+        index += length;
+
+        // Calculate the UTF-16 length: astral codepoints (4-byte UTF-8) take 2 code units.
+        if(!callback(length, length == 4 ? 2 : 1)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/// Remeasure the length (character count) of the content with the specified encoding kind.
+inline std::uint32_t remeasure(llvm::StringRef content, PositionEncodingKind kind) {
+    if(kind == PositionEncodingKind::UTF8) {
+        return content.size();
+    }
+
+    if(kind == PositionEncodingKind::UTF16) {
+        std::uint32_t length = 0;
+        iterateCodepoints(content, [&](std::uint32_t, std::uint32_t utf16Length) {
+            length += utf16Length;
+            return true;
+        });
+        return length;
+    }
+
+    if(kind == PositionEncodingKind::UTF32) {
+        std::uint32_t length = 0;
+        iterateCodepoints(content, [&](std::uint32_t, std::uint32_t) {
+            length += 1;
+            return true;
+        });
+        return length;
+    }
+
+    std::unreachable();
+}
+
+/// A table of the start offsets of all lines in a text, so that the line and column
+/// of an offset could be computed by binary search instead of scanning the text.
+class LineTable {
+public:
+    LineTable() = default;
+
+    explicit LineTable(llvm::StringRef content);
+
+    /// The text which the table is built from.
+    llvm::StringRef content() const {
+        return text;
+    }
+
+    /// Whether the text is pure ASCII, then the column is the same in all encodings.
+    bool is_ascii() const {
+        return ascii;
+    }
+
+    /// The count of lines, a text always has one line at least.
+    std::uint32_t size() const {
+        return starts.size();
+    }
+
+    /// Return the start offset of the given line (0-based).
+    std::uint32_t line_start(std::uint32_t line) const {
+        return starts[line];
+    }
+
+    /// Return the content of the given line (0-based), not including the line break.
+    llvm::StringRef line_content(std::uint32_t line) const;
+
+    /// Return the line (0-based) which contains the given offset.
+    std::uint32_t line(std::uint32_t offset) const;
+
+    /// Return the line and byte column (both 0-based) of the given offset.
+    std::pair<std::uint32_t, std::uint32_t> position(std::uint32_t offset) const {
+        auto line = this->line(offset);
+        return {line, offset - starts[line]};
+    }
+
+    /// Return the line and column (both 0-based) of the given offset, the column is
+    /// measured in the code units of given encoding.
+    std::pair<std::uint32_t, std::uint32_t> to_position(std::uint32_t offset,
+                                                        PositionEncodingKind encoding) const;
+
+    /// Return the offset of the given line and column, the inverse of `to_position`. The
+    /// position may come from the client, so it is clamped like the LSP specification says:
+    /// a line past the last one maps to the end of text, and a column past the end of line
+    /// maps to the end of line.
+    std::uint32_t to_offset(std::uint32_t line,
+                            std::uint32_t column,
+                            PositionEncodingKind encoding) const;
+
+private:
+    llvm::StringRef text;
+    bool ascii = true;
+    std::vector<std::uint32_t> starts = {0};
+};
+
+}  // namespace clice
@@ -519,6 +519,15 @@ auto CompilationDatabase::get_command(this Self& self, llvm::StringRef file, Com
     return info;
 }
 
+auto CompilationDatabase::files(this Self& self) -> std::vector<llvm::StringRef> {
+    std::vector<llvm::StringRef> files;
+    files.reserve(self.command_infos.size());
+    for(auto& [file, info]: self.command_infos) {
+        files.emplace_back(file);
+    }
+    return files;
+}
+
 auto CompilationDatabase::guess_or_fallback(this Self& self, llvm::StringRef file) -> LookupInfo {
     // Try to guess command from other file in same directory or parent directory
     llvm::StringRef dir = path::parent_path(file);
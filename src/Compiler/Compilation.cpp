@@ -88,13 +88,10 @@ private:
     std::shared_ptr<std::atomic_bool> stop;
 };
 
-/// create a `clang::CompilerInvocation` for compilation, it set and reset
-/// all necessary arguments and flags for clice compilation.
-auto create_invocation(CompilationParams& params,
-                       llvm::IntrusiveRefCntPtr<clang::DiagnosticsEngine>& diagnostic_engine)
+/// Run the driver to create a `clang::CompilerInvocation` from the arguments.
+auto run_driver(CompilationParams& params,
+                llvm::IntrusiveRefCntPtr<clang::DiagnosticsEngine>& diagnostic_engine)
     -> std::unique_ptr<clang::CompilerInvocation> {
-
-    /// Create clang invocation.
     clang::CreateInvocationOptions options = {
         .Diags = diagnostic_engine,
         .VFS = params.vfs,
@@ -104,7 +101,23 @@ auto create_invocation(CompilationParams& params,
         .ProbePrecompiled = false,
     };
 
-    auto invocation = clang::createInvocation(params.arguments, options);
+    return clang::createInvocation(params.arguments, options);
+}
+
+/// create a `clang::CompilerInvocation` for compilation, it set and reset
+/// all necessary arguments and flags for clice compilation.
+auto create_invocation(CompilationParams& params,
+                       llvm::IntrusiveRefCntPtr<clang::DiagnosticsEngine>& diagnostic_engine)
+    -> std::unique_ptr<clang::CompilerInvocation> {
+
+    std::unique_ptr<clang::CompilerInvocation> invocation;
+    if(params.invocation) {
+        /// Copy the prepared invocation, avoid running the driver again.
+        invocation = std::make_unique<clang::CompilerInvocation>(*params.invocation);
+    } else {
+        invocation = run_driver(params, diagnostic_engine);
+    }
+
     if(!invocation) {
         return nullptr;
     }
@@ -264,6 +277,14 @@ CompilationResult run_clang(CompilationParams& params,
 
 }  // namespace
 
+std::shared_ptr<const clang::CompilerInvocation> prepare_invocation(CompilationParams& params) {
+    auto diagnostic_engine =
+        clang::CompilerInstance::createDiagnostics(*params.vfs,
+                                                   new clang::DiagnosticOptions(),
+                                                   new clang::IgnoringDiagConsumer());
+    return run_driver(params, diagnostic_engine);
+}
+
 CompilationResult preprocess(CompilationParams& params) {
     return run_clang<clang::PreprocessOnlyAction>(params);
 }
@@ -316,9 +337,13 @@ CompilationResult compile(CompilationParams& params, PCMInfo& out) {
         },
         [&](CompilationUnit& unit) {
             out.path = params.output_file.str();
+            out.name = unit.module_name().str();
+            out.isInterfaceUnit = unit.is_module_interface_unit();
+            out.deps = unit.deps();
+            out.hash = computeInterfaceHash(unit);
 
-            for(auto& [name, path]: params.pcms) {
-                out.mods.emplace_back(name);
+            for(auto& import: unit.directives()[unit.interested_file()].imports) {
+                out.mods.emplace_back(import.name);
             }
         });
 }
@@ -330,17 +355,23 @@ CompilationResult complete(CompilationParams& params, clang::CodeCompleteConsume
     std::uint32_t line = 1;
     std::uint32_t column = 1;
 
-    /// FIXME:
-    assert(params.buffers.size() == 1);
-    llvm::StringRef content = params.buffers.begin()->second->getBuffer();
-
-    for(auto c: content.substr(0, offset)) {
-        if(c == '\n') {
-            line += 1;
-            column = 1;
-            continue;
+    if(params.line_table) {
+        auto [line0, column0] = params.line_table->position(offset);
+        line += line0;
+        column += column0;
+    } else {
+        /// FIXME:
+        assert(params.buffers.size() == 1);
+        llvm::StringRef content = params.buffers.begin()->second->getBuffer();
+
+        for(auto c: content.substr(0, offset)) {
+            if(c == '\n') {
+                line += 1;
+                column = 1;
+                continue;
+            }
+            column += 1;
         }
-        column += 1;
     }
 
     return run_clang<clang::SyntaxOnlyAction>(params, [&](clang::CompilerInstance& instance) {
@@ -1,121 +1,228 @@
 #include "Compiler/Module.h"
 #include "Compiler/Compilation.h"
 #include "clang/Lex/Lexer.h"
+#include "clang/AST/DeclCXX.h"
+#include "clang/Basic/Module.h"
+#include "llvm/Support/xxhash.h"
 
 namespace clice {
 
 std::string scanModuleName(CompilationParams& params) {
+    /// FIXME: Figure out main file from command line.
+    assert(params.buffers.size() == 1);
+    auto content = params.buffers.begin()->second->getBuffer();
+
     /// Because [P3034](https://github.com/cplusplus/papers/issues/1696) has been
     /// accepted, the module name in module declaration cannot be a macro now.
     /// It means that if the module declaration doesn't occur in condition preprocess
     /// directive, we can determine the module name just by lexing the source file.
+    if(auto info = scanModuleDirectives(content)) {
+        return info->isInterfaceUnit ? std::move(info->name) : "";
+    }
+
+    /// Otherwise, we have to preprocess the source file to determine the module name.
+    auto info = scanModule(params);
+    if(!info || !info->isInterfaceUnit) {
+        return "";
+    }
+
+    return info->name;
+}
+
+std::expected<ModuleInfo, std::string> scanModule(CompilationParams& params) {
+    ModuleInfo info;
+    auto unit = preprocess(params);
+    if(!unit) {
+        return std::unexpected(unit.error());
+    }
+
+    for(auto& import: unit->directives()[unit->interested_file()].imports) {
+        info.mods.emplace_back(import.name);
+    }
+
+    info.isInterfaceUnit = unit->is_module_interface_unit();
+    info.name = unit->module_name();
+
+    return info;
+}
+
+std::optional<ModuleInfo> scanModuleDirectives(llvm::StringRef content) {
     clang::LangOptions langOpts;
     langOpts.Modules = true;
     langOpts.CPlusPlus20 = true;
 
-    /// FIXME: Figure out main file from command line.
-    assert(params.buffers.size() == 1);
-    auto content = params.buffers.begin()->second->getBuffer();
-
-    /// We use raw mode of lexer to avoid the preprocessor.
     clang::Lexer lexer(clang::SourceLocation(),
                        langOpts,
                        content.begin(),
                        content.begin(),
                        content.end());
 
-    /// Whether we are in a condition directive.
-    bool isInDirective = false;
+    /// Lex a module name like `A.B:C`, the first token of it is already lexed.
+    auto lexName = [&lexer](clang::Token& token) {
+        std::string name;
+        while(true) {
+            auto kind = token.getKind();
+            if(kind == clang::tok::raw_identifier) {
+                name += token.getRawIdentifier();
+            } else if(kind == clang::tok::colon) {
+                name += ":";
+            } else if(kind == clang::tok::period) {
+                name += ".";
+            } else {
+                break;
+            }
+            lexer.LexFromRawLexer(token);
+        }
+        return name;
+    };
 
-    /// Whether we need to preprocess the source file.
-    bool needPreprocess = false;
+    ModuleInfo info;
 
-    std::string name;
-    clang::Token token;
-    while(true) {
-        lexer.LexFromRawLexer(token);
-        if(token.is(clang::tok::eof)) {
-            break;
-        }
+    /// The nesting depth of condition directives.
+    std::uint32_t depth = 0;
 
+    clang::Token token;
+    lexer.LexFromRawLexer(token);
+    while(token.isNot(clang::tok::eof)) {
+        /// Module declarations and imports must be at the start of line.
         if(!token.isAtStartOfLine()) {
+            lexer.LexFromRawLexer(token);
             continue;
         }
 
         if(token.is(clang::tok::hash)) {
             lexer.LexFromRawLexer(token);
-            auto diretive = token.getRawIdentifier();
-            if(diretive == "if" || diretive == "ifdef" || diretive == "ifndef") {
-                isInDirective = true;
-            } else if(diretive == "endif") {
-                isInDirective = false;
+            if(token.is(clang::tok::raw_identifier)) {
+                auto directive = token.getRawIdentifier();
+                if(directive == "if" || directive == "ifdef" || directive == "ifndef") {
+                    depth += 1;
+                } else if(directive == "endif" && depth > 0) {
+                    depth -= 1;
+                }
             }
-        } else if(token.is(clang::tok::raw_identifier)) {
-            if(token.getRawIdentifier() != "export") [[likely]] {
+            lexer.LexFromRawLexer(token);
+            continue;
+        }
+
+        if(token.isNot(clang::tok::raw_identifier)) {
+            lexer.LexFromRawLexer(token);
+            continue;
+        }
+
+        bool isExported = false;
+        if(token.getRawIdentifier() == "export") {
+            isExported = true;
+            lexer.LexFromRawLexer(token);
+            if(token.isNot(clang::tok::raw_identifier)) {
                 continue;
             }
+        }
 
+        auto keyword = token.getRawIdentifier();
+        if(keyword == "module") {
             lexer.LexFromRawLexer(token);
-            if(token.getRawIdentifier() != "module") {
+
+            /// `module;` starts the global module fragment and `module :private;`
+            /// starts the private module fragment, neither of them declares a module.
+            if(token.is(clang::tok::semi) || token.is(clang::tok::colon)) {
                 continue;
             }
 
-            /// We are after `export module`.
-            if(isInDirective) {
-                /// If the module name occurs in a condition directive, we have
-                /// to preprocess the source file to determine the module name.
-                needPreprocess = true;
-                break;
+            if(depth != 0) {
+                return std::nullopt;
             }
 
-            /// Otherwise, we can determine the module name directly.
-            while(!lexer.LexFromRawLexer(token)) {
-                auto kind = token.getKind();
-                if(kind == clang::tok::raw_identifier) {
-                    name += token.getRawIdentifier();
-                } else if(kind == clang::tok::colon) {
-                    name += ":";
-                } else if(kind == clang::tok::period) {
-                    name += ".";
-                } else {
-                    break;
-                }
+            info.isInterfaceUnit = isExported;
+            info.name = lexName(token);
+        } else if(keyword == "import") {
+            lexer.LexFromRawLexer(token);
+
+            /// Header units, e.g. `import <vector>;`, are not named modules.
+            if(token.is(clang::tok::less) || token.is(clang::tok::string_literal)) {
+                continue;
+            }
+
+            if(depth != 0) {
+                return std::nullopt;
+            }
+
+            auto name = lexName(token);
+            if(name.empty()) {
+                continue;
+            }
+
+            /// Partition is imported without the primary module name, e.g. `import :B;`.
+            if(name.front() == ':') {
+                name.insert(0, llvm::StringRef(info.name).split(':').first.str());
             }
-            return name;
+
+            info.mods.emplace_back(std::move(name));
         } else {
-            continue;
+            lexer.LexFromRawLexer(token);
         }
     }
 
-    /// If not need to preprocess and the function doesn't return, it means
-    /// that this file is not a module interface unit.
-    if(!needPreprocess) {
-        return "";
-    }
+    return info;
+}
 
-    auto info = scanModule(params);
-    if(!info) {
-        return "";
-    }
+std::uint64_t computeInterfaceHash(CompilationUnit& unit) {
+    auto& context = unit.context();
 
-    return info->name;
-}
+    clang::PrintingPolicy policy(context.getLangOpts());
+    clang::PrintingPolicy terse_policy = policy;
+    terse_policy.TerseOutput = true;
 
-std::expected<ModuleInfo, std::string> scanModule(CompilationParams& params) {
-    ModuleInfo info;
-    auto unit = preprocess(params);
-    if(!unit) {
-        return std::unexpected(unit.error());
-    }
+    std::string buffer;
+    llvm::raw_string_ostream os(buffer);
 
-    for(auto& import: unit->directives()[unit->interested_file()].imports) {
-        info.mods.emplace_back(import.name);
-    }
+    auto print = [&](this auto& self, clang::Decl* decl) -> void {
+        /// Declarations from other modules are not part of this interface.
+        if(decl->isImplicit() || decl->isFromASTFile()) {
+            return;
+        }
 
-    info.isInterfaceUnit = unit->is_module_interface_unit();
-    info.name = unit->module_name();
+        if(auto NS = llvm::dyn_cast<clang::NamespaceDecl>(decl)) {
+            os << "namespace " << NS->getName() << " {\n";
+            for(auto child: NS->noload_decls()) {
+                self(child);
+            }
+            os << "}\n";
+            return;
+        }
 
-    return info;
+        if(llvm::isa<clang::ExportDecl, clang::LinkageSpecDecl>(decl)) {
+            for(auto child: llvm::cast<clang::DeclContext>(decl)->noload_decls()) {
+                self(child);
+            }
+            return;
+        }
+
+        /// Declarations in global module fragment or private module
+        /// fragment are invisible to importers.
+        auto module = decl->getOwningModule();
+        if(!module || !module->isNamedModule()) {
+            return;
+        }
+
+        /// Importers could only see the signature of non-inline function.
+        if(auto function = llvm::dyn_cast<clang::FunctionDecl>(decl)) {
+            if(!function->isInlined() && !function->isConstexpr() &&
+               !function->isTemplated()) {
+                decl->print(os, terse_policy);
+                os << ";\n";
+                return;
+            }
+        }
+
+        decl->print(os, policy);
+        os << ";\n";
+    };
+
+    for(auto decl: unit.tu()->noload_decls()) {
+        print(decl);
+    }
+
+    return llvm::xxh3_64bits(buffer);
 }
 
 }  // namespace clice
@@ -2,6 +2,7 @@
 #include "AST/SymbolKind.h"
 #include "Compiler/Compilation.h"
 #include "Feature/CodeCompletion.h"
+#include "Support/Ranges.h"
 #include "Support/FuzzyMatcher.h"
 #include "clang/Basic/CharInfo.h"
 #include "clang/Sema/Sema.h"
@@ -186,17 +187,19 @@ CompletionItemKind completion_kind(const clang::NamedDecl* decl) {
     }
 }
 
-/// Calculate the final code completion result.
+/// Calculate the final code completion result. Candidates are only scored when processing,
+/// and at most `limit` best of them are kept, so that the strings of items are only rendered
+/// for the survivors.
 class CompletionRender {
 public:
     CompletionRender(clang::Sema& sema,
                      std::uint32_t offset,
                      llvm::StringRef content,
-                     std::vector<CompletionItem>& items,
+                     CodeCompletionResult& result,
                      clang::CodeCompletionContext& cc_context,
                      const config::CodeCompletionOption& option) :
         sema(sema), context(sema.getASTContext()), content(content),
-        prefix(CompletionPrefix::from(content, offset)), items(items), matcher(prefix.spelling),
+        prefix(CompletionPrefix::from(content, offset)), result(result), matcher(prefix.spelling),
         cc_context(cc_context), option(option) {}
 
     struct OverloadSet {
@@ -210,94 +213,154 @@ public:
         std::uint32_t count;
     };
 
+    /// A matched candidate waiting for ranking.
+    struct Candidate {
+        /// The score of candidate name.
+        float score;
+
+        /// The candidate from Sema, null for overload set.
+        clang::CodeCompletionResult* result = nullptr;
+
+        /// The overload set, null for single candidate.
+        const OverloadSet* overload = nullptr;
+    };
+
     /// Render edit text for declaration.
     std::string render(const clang::NamedDecl* decl) {
         return ast::name_of(decl);
     }
 
-    void process_candidate(clang::CodeCompletionResult& candidate) {
-        feature::CompletionItem item;
+    /// Get the name of candidate, `storage` is used if the name needs to be rendered.
+    static llvm::StringRef name_of(const clang::CodeCompletionResult& candidate,
+                                   std::string& storage) {
+        switch(candidate.Kind) {
+            case clang::CodeCompletionResult::RK_Keyword: {
+                return candidate.Keyword;
+            }
 
-        item.edit.range = prefix.range;
+            case clang::CodeCompletionResult::RK_Pattern: {
+                storage = candidate.Pattern->getAllTypedText();
+                return storage;
+            }
 
-        /// Check whether the name matchs, if so, set the item.
-        auto check_name = [&](llvm::StringRef name) {
-            auto score = matcher.match(name);
-            if(!score) {
-                return false;
+            case clang::CodeCompletionResult::RK_Macro: {
+                return candidate.Macro->getName();
             }
 
-            item.label = name;
-            item.score = *score;
-            item.edit.text = item.label;
-            return true;
+            case clang::CodeCompletionResult::RK_Declaration: {
+                if(auto identifier = candidate.Declaration->getIdentifier()) {
+                    return identifier->getName();
+                }
+                storage = ast::name_of(candidate.Declaration);
+                return storage;
+            }
+        }
+
+        std::unreachable();
+    }
+
+    /// Only keep `limit` best candidates with a min heap, the top of heap is the
+    /// worst one among them.
+    void add_candidate(Candidate candidate) {
+        auto better = [](const Candidate& lhs, const Candidate& rhs) {
+            return lhs.score > rhs.score;
         };
 
+        matched += 1;
+        if(option.limit == 0 || candidates.size() < option.limit) {
+            candidates.emplace_back(candidate);
+            ranges::push_heap(candidates, better);
+        } else if(candidate.score > candidates.front().score) {
+            ranges::pop_heap(candidates, better);
+            candidates.back() = candidate;
+            ranges::push_heap(candidates, better);
+        }
+    }
+
+    void process_candidate(clang::CodeCompletionResult& candidate) {
+        std::string storage;
+        auto name = name_of(candidate, storage);
+
+        auto score = matcher.match(name);
+        if(!score) {
+            return;
+        }
+
+        /// If bundle_overloads is enabled and this is a function, just
+        /// increase the overload count.
+        if(candidate.Kind == clang::CodeCompletionResult::RK_Declaration &&
+           option.bundle_overloads &&
+           completion_kind(candidate.Declaration) == CompletionItemKind::Function) {
+            auto declaration = candidate.Declaration;
+            llvm::SmallString<256> qualfied_name;
+            llvm::raw_svector_ostream os(qualfied_name);
+            declaration->printQualifiedName(os);
+
+            auto hash = llvm::xxh3_64bits(qualfied_name);
+            OverloadSet set{declaration, *score, 1};
+            auto [it, success] = overloads.try_emplace(hash, set);
+            if(!success) {
+                it->second.count += 1;
+            }
+            return;
+        }
+
+        add_candidate({.score = *score, .result = &candidate});
+    }
+
+    /// Render the completion item of a single candidate.
+    CompletionItem render(clang::CodeCompletionResult& candidate, float score) {
+        CompletionItem item;
+        std::string storage;
+        item.label = name_of(candidate, storage);
+        item.score = score;
+        item.edit.text = item.label;
+        item.edit.range = prefix.range;
+
         switch(candidate.Kind) {
             case clang::CodeCompletionResult::RK_Keyword: {
-                if(!check_name(candidate.Keyword)) {
-                    return;
-                }
-
-                item.edit.text = item.label;
                 item.kind = feature::CompletionItemKind::Keyword;
-                item.edit.text = item.label;
                 break;
             }
 
             case clang::CodeCompletionResult::RK_Pattern: {
-                auto text = candidate.Pattern->getAllTypedText();
-                if(!check_name(text)) {
-                    return;
-                }
-
                 item.kind = CompletionItemKind::Snippet;
-                item.edit.text = item.label;
                 break;
             }
 
             case clang::CodeCompletionResult::RK_Macro: {
-                if(!check_name(candidate.Macro->getName())) {
-                    return;
-                }
-
                 item.kind = feature::CompletionItemKind::Unit;
-                item.edit.text = item.label;
                 break;
             }
 
             case clang::CodeCompletionResult::RK_Declaration: {
-                auto declaration = candidate.Declaration;
-                /// if(declaration)
-                ///  auto name = getDeclName();
-                if(!check_name(ast::name_of(declaration))) {
-                    return;
-                }
+                item.kind = completion_kind(candidate.Declaration);
+                item.edit.text = render(candidate.Declaration);
+                break;
+            }
+        }
 
-                /// Otherwise just add this declaration.
-                item.kind = completion_kind(declaration);
-
-                /// If bundle_overloads is enabled and this is a function, just
-                /// increase the overload count.
-                if(option.bundle_overloads && item.kind == CompletionItemKind::Function) {
-                    llvm::SmallString<256> qualfied_name;
-                    llvm::raw_svector_ostream os(qualfied_name);
-                    declaration->printQualifiedName(os);
-
-                    auto hash = llvm::xxh3_64bits(qualfied_name);
-                    OverloadSet set{declaration, item.score, 1};
-                    auto [it, success] = overloads.try_emplace(hash, set);
-                    if(!success) {
-                        it->second.count += 1;
-                    }
-                    return;
-                }
+        return item;
+    }
 
-                item.edit.text = render(declaration);
-            }
+    /// Render the completion item of an overload set.
+    CompletionItem render(const OverloadSet& overload_set) {
+        CompletionItem item;
+        item.label = ast::name_of(overload_set.first);
+        item.kind = CompletionItemKind::Function;
+        item.score = overload_set.score;
+        item.edit.range = prefix.range;
+
+        if(overload_set.count == 1) {
+            item.edit.text = render(overload_set.first);
+            /// TODO: Render function signature.
+            item.description = "";
+        } else {
+            item.edit.text = item.label;
+            item.description = "(...)";
         }
 
-        items.emplace_back(std::move(item));
+        return item;
     }
 
     /// TODO: Handle dependent name with `TemplateResolver`.
@@ -314,24 +377,26 @@ public:
     }
 
     ~CompletionRender() {
-        /// Add overload set.
+        /// Overload sets are complete only after all candidates are processed.
         for(auto& [_, overload_set]: overloads) {
-            CompletionItem item;
-            item.label = ast::name_of(overload_set.first);
-            item.kind = CompletionItemKind::Function;
-            item.score = overload_set.score;
-            item.edit.range = prefix.range;
-
-            if(overload_set.count == 1) {
-                item.edit.text = render(overload_set.first);
-                /// TODO: Render function signature.
-                item.description = "";
+            add_candidate({.score = overload_set.score, .overload = &overload_set});
+        }
+
+        if(option.limit != 0 && matched > option.limit) {
+            result.incomplete = true;
+        }
+
+        /// Render the survivors from the best to the worst.
+        ranges::sort(candidates, [](const Candidate& lhs, const Candidate& rhs) {
+            return lhs.score > rhs.score;
+        });
+
+        for(auto& candidate: candidates) {
+            if(candidate.overload) {
+                result.items.emplace_back(render(*candidate.overload));
             } else {
-                item.edit.text = item.label;
-                item.description = "(...)";
+                result.items.emplace_back(render(*candidate.result, candidate.score));
             }
-
-            items.emplace_back(std::move(item));
         }
     }
 
@@ -351,8 +416,14 @@ private:
     /// The fuzzy matcher to score results.
     FuzzyMatcher matcher;
 
-    /// The code completion results.
-    std::vector<CompletionItem>& items;
+    /// The code completion result.
+    CodeCompletionResult& result;
+
+    /// The best candidates so far, organized as a min heap.
+    std::vector<Candidate> candidates;
+
+    /// The count of all matched candidates.
+    std::uint32_t matched = 0;
 
     /// The code completion context.
     clang::CodeCompletionContext& cc_context;
@@ -367,10 +438,10 @@ private:
 class CodeCompletionCollector final : public clang::CodeCompleteConsumer {
 public:
     CodeCompletionCollector(std::uint32_t offset,
-                            std::vector<CompletionItem>& items,
+                            CodeCompletionResult& result,
                             const config::CodeCompletionOption& option) :
         clang::CodeCompleteConsumer({}), offset(offset),
-        info(std::make_shared<clang::GlobalCodeCompletionAllocator>()), items(items),
+        info(std::make_shared<clang::GlobalCodeCompletionAllocator>()), result(result),
         option(option) {}
 
     clang::CodeCompletionAllocator& getAllocator() final {
@@ -405,7 +476,7 @@ public:
         auto& src_mgr = sema.getSourceManager();
         auto content = src_mgr.getBufferData(src_mgr.getMainFileID());
 
-        CompletionRender render(sema, offset, content, items, cc_context, option);
+        CompletionRender render(sema, offset, content, result, cc_context, option);
 
         for(auto& candidate: llvm::make_range(candidates, candidates + candidates_count)) {
             render.process_candidate(candidate);
@@ -415,23 +486,47 @@ public:
 private:
     std::uint32_t offset;
     clang::CodeCompletionTUInfo info;
-    std::vector<CompletionItem>& items;
+    CodeCompletionResult& result;
     const config::CodeCompletionOption& option;
 };
 
 }  // namespace
 
-std::vector<CompletionItem> code_complete(CompilationParams& params,
-                                          const config::CodeCompletionOption& option) {
-    std::vector<CompletionItem> items;
+CodeCompletionResult code_complete(CompilationParams& params,
+                                   const config::CodeCompletionOption& option) {
+    CodeCompletionResult result;
     auto& [file, offset] = params.completion;
-    auto consumer = new CodeCompletionCollector(offset, items, option);
+    auto consumer = new CodeCompletionCollector(offset, result, option);
 
     if(auto info = complete(params, consumer)) {
         /// TODO: Handle error here.
     }
 
-    return items;
+    return result;
+}
+
+LocalSourceRange completion_prefix(llvm::StringRef content, std::uint32_t offset) {
+    return CompletionPrefix::from(content, offset).range;
+}
+
+std::vector<CompletionItem> filter_completion(llvm::ArrayRef<CompletionItem> items,
+                                              llvm::StringRef content,
+                                              std::uint32_t offset) {
+    auto prefix = CompletionPrefix::from(content, offset);
+    FuzzyMatcher matcher(prefix.spelling);
+
+    std::vector<CompletionItem> result;
+    for(auto& item: items) {
+        auto score = matcher.match(item.label);
+        if(!score) {
+            continue;
+        }
+
+        auto& back = result.emplace_back(item);
+        back.score = *score;
+        back.edit.range = prefix.range;
+    }
+    return result;
 }
 
 }  // namespace clice::feature
@@ -10,6 +10,9 @@ json::Value diagnostics(PositionEncodingKind kind, PathMapping mapping, Compilat
 
     std::optional<proto::Diagnostic> diagnostic;
 
+    /// Most diagnostics are in the main file, share the line table of it.
+    PositionConverter converter(unit.interested_content(), kind);
+
     auto flush = [&]() {
         if(diagnostic) {
             /// FIXME: We should use a better way?
@@ -42,12 +45,13 @@ json::Value diagnostics(PositionEncodingKind kind, PathMapping mapping, Compilat
                 continue;
             }
 
-            auto content = unit.file_content(fid);
-            PositionConverter converter(content, kind);
-
             proto::Location location;
-            location.range.start = converter.toPosition(raw_diagnostic.range.begin);
-            location.range.end = converter.toPosition(raw_diagnostic.range.end);
+            if(fid == unit.interested_file()) {
+                location.range = converter.lookup(raw_diagnostic.range);
+            } else {
+                PositionConverter related(unit.file_content(fid), kind);
+                location.range = related.lookup(raw_diagnostic.range);
+            }
             location.uri = mapping.to_uri(unit.file_path(fid));
 
             diagnostic->relatedInformation.emplace_back(std::move(location),
@@ -63,12 +67,9 @@ json::Value diagnostics(PositionEncodingKind kind, PathMapping mapping, Compilat
         if(fid.isInvalid()) {
             diagnostic->range = {0, 0, 0, 0};
         } else if(fid == unit.interested_file()) {
-            PositionConverter converter(unit.interested_content(), kind);
             diagnostic->range.start = converter.toPosition(raw_diagnostic.range.begin);
             diagnostic->range.end = converter.toPosition(raw_diagnostic.range.end);
         } else {
-            PositionConverter converter(unit.interested_content(), kind);
-
             /// Get the top level include location.
             auto include_location = unit.include_location(fid);
             while(true) {
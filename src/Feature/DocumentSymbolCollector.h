@@ -0,0 +1,133 @@
+#pragma once
+
+#include "AST/FilterASTVisitor.h"
+#include "Compiler/Compilation.h"
+#include "Feature/DocumentSymbol.h"
+#include "Support/Ranges.h"
+#include "Support/Compare.h"
+
+namespace clice::feature {
+
+/// The detail text of symbol, e.g. the type of variable.
+std::string symbol_detail(clang::ASTContext& Ctx, const clang::NamedDecl& ND);
+
+/// Use DFS to traverse the AST and collect document symbols.
+class DocumentSymbolCollector : public FilteredASTVisitor<DocumentSymbolCollector> {
+
+public:
+    using Base = FilteredASTVisitor<DocumentSymbolCollector>;
+
+    DocumentSymbolCollector(CompilationUnit& unit, bool interested_only) :
+        Base(unit, interested_only) {}
+
+    bool is_interested(clang::Decl* decl) {
+        switch(decl->getKind()) {
+            case clang::Decl::Namespace:
+            case clang::Decl::Enum:
+            case clang::Decl::EnumConstant:
+            case clang::Decl::Function:
+            case clang::Decl::CXXMethod:
+            case clang::Decl::CXXConstructor:
+            case clang::Decl::CXXDestructor:
+            case clang::Decl::CXXConversion:
+            case clang::Decl::CXXDeductionGuide:
+            case clang::Decl::Record:
+            case clang::Decl::CXXRecord:
+            case clang::Decl::Field:
+            case clang::Decl::Var:
+            case clang::Decl::Binding:
+            case clang::Decl::Concept: {
+                return true;
+            }
+
+            default: {
+                return false;
+            }
+        }
+    }
+
+    bool on_traverse_decl(clang::Decl* decl, auto MF) {
+        on_enter_decl(decl);
+
+        /// The children of skipped declaration needn't be traversed.
+        bool res = skipped != 0 || (this->*MF)(decl);
+
+        on_leave_decl(decl);
+        return res;
+    }
+
+    /// Add the symbol of declaration and make it the parent of following symbols,
+    /// until the declaration is left.
+    void on_enter_decl(clang::Decl* decl) {
+        /// All descendants of a skipped declaration are skipped.
+        if(skipped != 0) {
+            skipped += 1;
+            return;
+        }
+
+        if(!is_interested(decl)) {
+            parents.emplace_back();
+            return;
+        }
+
+        auto ND = llvm::cast<clang::NamedDecl>(decl);
+        auto [fid, selection_range] =
+            unit.decompose_range(unit.expansion_location(ND->getLocation()));
+        auto [fid2, range] = unit.decompose_expansion_range(ND->getSourceRange());
+        if(fid != fid2) {
+            skipped = 1;
+            return;
+        }
+
+        auto& frame = interested_only ? result : sharedResult[fid];
+        parents.emplace_back(fid, frame.cursor);
+
+        /// Add new symbol.
+        auto& symbol = frame.cursor->emplace_back();
+        symbol.kind = SymbolKind::from(decl);
+        symbol.name = ast::display_name_of(ND);
+        symbol.detail = symbol_detail(unit.context(), *ND);
+        symbol.selectionRange = selection_range;
+        symbol.range = range;
+
+        /// Adjust the node.
+        frame.cursor = &symbol.children;
+    }
+
+    void on_leave_decl(clang::Decl* decl) {
+        if(skipped != 0) {
+            skipped -= 1;
+            return;
+        }
+
+        /// When all children node are set, go back to last node.
+        auto [fid, cursor] = parents.pop_back_val();
+        if(cursor) {
+            (interested_only ? result : sharedResult[fid]).cursor = cursor;
+        }
+    }
+
+    DocumentSymbols finish_for_file() {
+        ranges::sort(result.symbols, refl::less);
+        return std::move(result.symbols);
+    }
+
+public:
+    struct SymbolFrame {
+        DocumentSymbols symbols;
+        DocumentSymbols* cursor = &symbols;
+    };
+
+    SymbolFrame result;
+    index::Shared<SymbolFrame> sharedResult;
+
+private:
+    /// The file and the cursor to restore for each entered declaration, the
+    /// cursor is null if nothing is added.
+    llvm::SmallVector<std::pair<clang::FileID, DocumentSymbols*>> parents;
+
+    /// The depth of declarations being skipped.
+    std::uint32_t skipped = 0;
+};
+
+}  // namespace clice::feature
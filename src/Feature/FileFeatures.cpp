@@ -0,0 +1,23 @@
+#include "FoldingRangeCollector.h"
+#include "DocumentSymbolCollector.h"
+#include "Feature/FileFeatures.h"
+
+namespace clice::feature {
+
+FileFeatures file_features(CompilationUnit& unit) {
+    FileFeatures features;
+
+    FoldingRangeCollector folding(unit, true);
+    DocumentSymbolCollector symbol(unit, true);
+    FusedASTVisitor(unit, true, folding, symbol).TraverseDecl(unit.tu());
+    features.folding_ranges = folding.finish_for_file(unit);
+    features.document_symbols = symbol.finish_for_file();
+
+    /// Semantic tokens are collected by `SemanticVisitor` which overrides the traversal
+    /// of some nodes, so it cannot be fused with others.
+    features.semantic_tokens = semantic_tokens(unit);
+    features.document_links = document_links(unit);
+    return features;
+}
+
+}  // namespace clice::feature
@@ -45,9 +45,9 @@ std::vector<proto::TextEdit> document_format(llvm::StringRef file,
         return edits;
     }
 
+    PositionConverter converter(content, PositionEncodingKind::UTF8);
     for(auto& replacement: *replacements) {
         proto::TextEdit edit;
-        PositionConverter converter(content, PositionEncodingKind::UTF8);
         edit.range.start = converter.toPosition(replacement.getOffset());
         edit.range.end = converter.toPosition(replacement.getOffset() + replacement.getLength());
         edit.newText = replacement.getReplacementText();
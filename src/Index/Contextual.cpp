@@ -0,0 +1,122 @@
+#include "Index/Contextual.h"
+#include "Support/Ranges.h"
+
+namespace clice::index {
+
+ContextSet::ContextSet(const ContextSet& other) :
+    ids(other.ids), dense_count(other.dense_count) {
+    if(other.bits) {
+        bits = std::make_unique<llvm::BitVector>(*other.bits);
+    }
+}
+
+ContextSet& ContextSet::operator=(const ContextSet& other) {
+    if(this != &other) {
+        ids = other.ids;
+        bits = other.bits ? std::make_unique<llvm::BitVector>(*other.bits) : nullptr;
+        dense_count = other.dense_count;
+    }
+    return *this;
+}
+
+bool ContextSet::test(std::uint32_t id) const {
+    if(bits) {
+        return id < bits->size() && bits->test(id);
+    }
+    return ranges::binary_search(ids, id);
+}
+
+void ContextSet::set(std::uint32_t id) {
+    if(bits) {
+        if(id >= bits->size()) {
+            bits->resize(id + 1);
+        }
+        if(!bits->test(id)) {
+            bits->set(id);
+            dense_count += 1;
+        }
+        return;
+    }
+
+    auto it = ranges::lower_bound(ids, id);
+    if(it != ids.end() && *it == id) {
+        return;
+    }
+
+    if(ids.size() < SparseLimit) {
+        ids.insert(it, id);
+        return;
+    }
+
+    /// Too many ids, switch to dense representation.
+    bits = std::make_unique<llvm::BitVector>(std::max(id, ids.back()) + 1);
+    for(auto exist: ids) {
+        bits->set(exist);
+    }
+    bits->set(id);
+    dense_count = ids.size() + 1;
+    ids.clear();
+}
+
+void ContextSet::reset(std::uint32_t id) {
+    if(bits) {
+        if(id < bits->size() && bits->test(id)) {
+            bits->reset(id);
+            dense_count -= 1;
+            shrink();
+        }
+        return;
+    }
+
+    auto it = ranges::lower_bound(ids, id);
+    if(it != ids.end() && *it == id) {
+        ids.erase(it);
+    }
+}
+
+std::uint32_t ContextSet::count() const {
+    return bits ? dense_count : ids.size();
+}
+
+void ContextSet::shrink() {
+    /// Use half of the limit, so that a set around the limit doesn't switch back and forth.
+    if(dense_count > SparseLimit / 2) {
+        return;
+    }
+
+    ids.clear();
+    for(auto id: bits->set_bits()) {
+        ids.emplace_back(id);
+    }
+    bits.reset();
+    dense_count = 0;
+}
+
+ContextSet& ContextSet::operator&=(const ContextSet& other) {
+    if(bits && other.bits) {
+        *bits &= *other.bits;
+        dense_count = bits->count();
+        shrink();
+        return *this;
+    }
+
+    if(bits) {
+        /// The result is a subset of the sparse one.
+        llvm::SmallVector<std::uint32_t, 2> result;
+        for(auto id: other.ids) {
+            if(test(id)) {
+                result.emplace_back(id);
+            }
+        }
+        ids = std::move(result);
+        bits.reset();
+        dense_count = 0;
+        return *this;
+    }
+
+    auto removed = ranges::remove_if(ids, [&](std::uint32_t id) { return !other.test(id); });
+    ids.erase(removed.begin(), removed.end());
+    return *this;
+}
+
+}  // namespace clice::index
@@ -1,18 +1,28 @@
 #include "Compiler/CompilationUnit.h"
 #include "Support/Binary.h"
 #include "Index/FeatureIndex.h"
+#include "llvm/Support/xxhash.h"
 
 namespace clice::index {
 
 namespace memory {
 
+/// Increase it when the layout of `FeatureIndex` is changed.
+constexpr std::uint32_t FeatureIndexVersion = 1;
+
 struct FeatureIndex {
+    /// The version of layout.
+    std::uint32_t version = FeatureIndexVersion;
+
     /// The path of source file.
     std::string path;
 
     /// The content of source file.
     std::string content;
 
+    /// The hash of content, used to check whether the index is outdated.
+    std::uint64_t hash;
+
     /// The index of semantic tokens.
     feature::SemanticTokens tokens;
 
@@ -28,6 +38,92 @@ struct FeatureIndex {
 
 }  // namespace memory
 
+static_assert(std::is_same_v<binary::binarify_t<feature::SemanticToken>, feature::SemanticToken>,
+              "semantic tokens are expected to be stored as is");
+
+namespace {
+
+template <typename View, typename T>
+LazyArray<View> lazy_array(binary::Proxy<std::vector<T>> proxy) {
+    auto [offset, size] = proxy.value();
+    return LazyArray<View>(proxy.base,
+                           static_cast<const char*>(proxy.base) + offset,
+                           size,
+                           sizeof(binary::binarify_t<T>));
+}
+
+}  // namespace
+
+LocalSourceRange FoldingRange::range() const {
+    return binary::Proxy<feature::FoldingRange>{base, data}.get<"range">().value();
+}
+
+feature::FoldingRangeKind FoldingRange::kind() const {
+    return binary::Proxy<feature::FoldingRange>{base, data}.get<"kind">().value();
+}
+
+llvm::StringRef FoldingRange::text() const {
+    return binary::Proxy<feature::FoldingRange>{base, data}.get<"text">().as_string();
+}
+
+LocalSourceRange DocumentLink::range() const {
+    return binary::Proxy<feature::DocumentLink>{base, data}.get<"range">().value();
+}
+
+llvm::StringRef DocumentLink::file() const {
+    return binary::Proxy<feature::DocumentLink>{base, data}.get<"file">().as_string();
+}
+
+LocalSourceRange DocumentSymbol::selectionRange() const {
+    return binary::Proxy<feature::DocumentSymbol>{base, data}.get<"selectionRange">().value();
+}
+
+LocalSourceRange DocumentSymbol::range() const {
+    return binary::Proxy<feature::DocumentSymbol>{base, data}.get<"range">().value();
+}
+
+SymbolKind DocumentSymbol::kind() const {
+    return binary::Proxy<feature::DocumentSymbol>{base, data}.get<"kind">().value();
+}
+
+llvm::StringRef DocumentSymbol::name() const {
+    return binary::Proxy<feature::DocumentSymbol>{base, data}.get<"name">().as_string();
+}
+
+llvm::StringRef DocumentSymbol::detail() const {
+    return binary::Proxy<feature::DocumentSymbol>{base, data}.get<"detail">().as_string();
+}
+
+LazyArray<DocumentSymbol> DocumentSymbol::children() const {
+    binary::Proxy<feature::DocumentSymbol> symbol{base, data};
+    return lazy_array<DocumentSymbol>(symbol.get<"children">());
+}
+
+std::optional<FeatureIndex> FeatureIndex::load(llvm::StringRef file) {
+    auto buffer = llvm::MemoryBuffer::getFile(file,
+                                              /*IsText=*/false,
+                                              /*RequiresNullTerminator=*/false);
+    if(!buffer) {
+        return std::nullopt;
+    }
+
+    auto size = buffer.get()->getBufferSize();
+    if(size < sizeof(binary::binarify_t<memory::FeatureIndex>)) {
+        return std::nullopt;
+    }
+
+    auto base = const_cast<char*>(buffer.get()->getBufferStart());
+    binary::Proxy<memory::FeatureIndex> index{base, base};
+    if(index.get<"version">().value() != memory::FeatureIndexVersion ||
+       !binary::validate(index, size)) {
+        return std::nullopt;
+    }
+
+    FeatureIndex result(base, size);
+    result.buffer = std::move(buffer.get());
+    return result;
+}
+
 llvm::StringRef FeatureIndex::path() {
     binary::Proxy<memory::FeatureIndex> index{base, base};
     return index.get<"path">().as_string();
@@ -38,6 +134,11 @@ llvm::StringRef FeatureIndex::content() {
     return index.get<"content">().as_string();
 }
 
+std::uint64_t FeatureIndex::hash() {
+    binary::Proxy<memory::FeatureIndex> index{base, base};
+    return index.get<"hash">().value();
+}
+
 feature::SemanticTokens FeatureIndex::semanticTokens() const {
     binary::Proxy<memory::FeatureIndex> index{base, base};
     return binary::deserialize(index.get<"tokens">());
@@ -58,6 +159,59 @@ feature::DocumentSymbols FeatureIndex::documentSymbols() const {
     return binary::deserialize(index.get<"symbols">());
 }
 
+llvm::ArrayRef<feature::SemanticToken> FeatureIndex::tokens() const {
+    binary::Proxy<memory::FeatureIndex> index{base, base};
+    return index.get<"tokens">().as_array();
+}
+
+llvm::ArrayRef<feature::SemanticToken> FeatureIndex::tokens(LocalSourceRange range) const {
+    /// Tokens are sorted by range, so the slice is contiguous.
+    auto tokens = this->tokens();
+    auto first = std::ranges::partition_point(tokens, [&](const feature::SemanticToken& token) {
+        return token.range.begin < range.begin;
+    });
+    auto last = std::ranges::partition_point(first,
+                                             tokens.end(),
+                                             [&](const feature::SemanticToken& token) {
+                                                 return token.range.begin < range.end;
+                                             });
+    return llvm::ArrayRef(first, last);
+}
+
+LazyArray<FoldingRange> FeatureIndex::foldings() const {
+    binary::Proxy<memory::FeatureIndex> index{base, base};
+    return lazy_array<FoldingRange>(index.get<"foldings">());
+}
+
+std::vector<FoldingRange> FeatureIndex::foldings(LocalSourceRange range) const {
+    /// Foldings are sorted by their begin, those begin after the range are skipped by
+    /// binary search. The earlier ones may still enclose the range, check their end.
+    auto foldings = this->foldings();
+    auto indices = std::views::iota(0u, foldings.length());
+    auto last = std::ranges::partition_point(indices, [&](std::uint32_t i) {
+        return foldings[i].range().begin <= range.end;
+    });
+
+    std::vector<FoldingRange> result;
+    for(auto i: std::ranges::subrange(indices.begin(), last)) {
+        auto folding = foldings[i];
+        if(folding.range().end >= range.begin) {
+            result.emplace_back(folding);
+        }
+    }
+    return result;
+}
+
+LazyArray<DocumentLink> FeatureIndex::links() const {
+    binary::Proxy<memory::FeatureIndex> index{base, base};
+    return lazy_array<DocumentLink>(index.get<"links">());
+}
+
+LazyArray<DocumentSymbol> FeatureIndex::symbols() const {
+    binary::Proxy<memory::FeatureIndex> index{base, base};
+    return lazy_array<DocumentSymbol>(index.get<"symbols">());
+}
+
 Shared<std::vector<char>> FeatureIndex::build(CompilationUnit& unit) {
     Shared<memory::FeatureIndex> indices;
 
@@ -82,6 +236,7 @@ Shared<std::vector<char>> FeatureIndex::build(CompilationUnit& unit) {
     for(auto&& [fid, index]: indices) {
         index.path = unit.file_path(fid);
         index.content = unit.file_content(fid);
+        index.hash = llvm::xxh3_64bits(index.content);
         auto [buffer, _] = binary::serialize(index);
         result.try_emplace(fid, std::move(buffer));
     }
@@ -1,3 +1,5 @@
+#include <optional>
+
 #include "Index/HeaderIndex.h"
 
 namespace clice::index::memory {
@@ -27,6 +29,7 @@ std::uint32_t HeaderIndex::alloc_cctx_id() {
         cctx_hctx_refs[new_cctx_id] = 1;
         cctx_element_refs[new_cctx_id] = 0;
     }
+    empty_cctx_ids.set(new_cctx_id);
     return new_cctx_id;
 }
 
@@ -56,6 +59,7 @@ void HeaderIndex::remove(this HeaderIndex& self, llvm::StringRef path) {
             erased_cctx_ids.push_back(cctx_id);
             self.erased_cctx_ids.push_back(cctx_id);
             self.cctx_element_refs[cctx_id] = 0;
+            self.empty_cctx_ids.reset(cctx_id);
         }
     }
 
@@ -69,10 +73,12 @@ void HeaderIndex::remove(this HeaderIndex& self, llvm::StringRef path) {
     }
 
     /// Remove all refs to this canonical context id.
-    Bitmap erased_flag = self.erased_flag();
-
-    for(auto& state: self.dependent_elem_states) {
-        state &= erased_flag;
+    if(!erased_cctx_ids.empty()) {
+        for(auto& state: self.dependent_elem_states) {
+            for(auto cctx_id: erased_cctx_ids) {
+                state.reset(cctx_id);
+            }
+        }
     }
 }
 
@@ -144,7 +150,9 @@ auto HeaderIndex::merge(this HeaderIndex& self,
     /// We could make sure the other has only one header context.
     std::uint32_t new_hctx_id = self.alloc_hctx_id();
 
-    Bitmap flag = self.erased_flag();
+    /// The canonical contexts that all visited elements occur in. It is initialized
+    /// lazily by the first visited element, null means all active contexts.
+    std::optional<Bitmap> flag;
     bool is_new_cctx = false;
     std::uint32_t new_cctx_id = -1;
 
@@ -186,9 +194,14 @@ auto HeaderIndex::merge(this HeaderIndex& self,
                 } else {
                     /// If this element is not new and we still cannot make sure whether this is
                     /// new canonical context.
-                    flag &= self.dependent_elem_states[self_elem.offset()];
+                    auto& state = self.dependent_elem_states[self_elem.offset()];
+                    if(flag) {
+                        *flag &= state;
+                    } else {
+                        flag = state;
+                    }
                     visited_elem_ids.emplace_back(self_elem.offset());
-                    if(flag.none()) {
+                    if(flag->none()) {
                         is_new_cctx = true;
                     }
                 }
@@ -202,17 +215,19 @@ auto HeaderIndex::merge(this HeaderIndex& self,
     merge_elements(self, raw, update_context);
 
     if(!is_new_cctx) {
-        assert(new_cctx_id == -1 && flag.any());
-        for(auto i = 0; i < self.max_cctx_id; i++) {
-            if(!flag.test(i)) {
-                continue;
-            }
+        /// No old dependent element is visited, only a context without any could be reused.
+        if(!flag) {
+            flag = self.empty_cctx_ids;
+        }
 
+        assert(new_cctx_id == -1);
+        flag->for_each([&](std::uint32_t i) {
             if(self.cctx_element_refs[i] == old_elements_refs) {
                 new_cctx_id = i;
-                break;
+                return false;
             }
-        }
+            return true;
+        });
     }
 
     if(new_cctx_id == -1) {
@@ -226,6 +241,9 @@ auto HeaderIndex::merge(this HeaderIndex& self,
             self.dependent_elem_states[id].set(new_cctx_id);
         }
         self.cctx_element_refs[new_cctx_id] = old_elements_refs;
+        if(old_elements_refs != 0) {
+            self.empty_cctx_ids.reset(new_cctx_id);
+        }
     }
 
     return self.header_contexts[path].emplace_back(HeaderContext{
@@ -1,7 +1,9 @@
+#include "AST/Utility.h"
 #include "AST/Semantic.h"
 #include "Index/Index.h"
 #include "Index/IncludeGraph.h"
 #include "Support/Format.h"
+#include "Support/Ranges.h"
 
 namespace clice::index::memory {
 
@@ -32,6 +34,109 @@ public:
         return index;
     }
 
+    /// Occurrences and relations of a file. They are appended during visiting, most of them
+    /// are duplicated (e.g. a reference visited by multiple paths), and inserted into the
+    /// hash tables of index only once after sorting and deduplicating.
+    struct File {
+        RawIndex* index;
+
+        std::vector<std::pair<LocalSourceRange, SymbolID>> occurrences;
+
+        std::vector<std::pair<SymbolID, Relation>> relations;
+    };
+
+    File& getFile(clang::FileID fid) {
+        /// Consecutive occurrences are usually in the same file.
+        if(last_file && fid == last_fid) {
+            return *last_file;
+        }
+
+        auto [it, inserted] = files.try_emplace(fid);
+        if(inserted) {
+            it->second.index = &getIndex(fid);
+        }
+
+        last_fid = fid;
+        last_file = &it->second;
+        return *last_file;
+    }
+
+    void add_occurrence(File& file, LocalSourceRange range, SymbolID symbol) {
+        file.occurrences.emplace_back(range, symbol);
+    }
+
+    void add_relation(File& file, SymbolID symbol, Relation relation) {
+        file.relations.emplace_back(symbol, relation);
+    }
+
+    /// Sort the elements and remove the duplicated ones, the first one of equal elements
+    /// is kept like inserting into hash tables.
+    template <typename T>
+    static void deduplicate(std::vector<T>& elements, auto key) {
+        ranges::stable_sort(elements, {}, key);
+        auto [first, last] = ranges::unique(elements, {}, key);
+        elements.erase(first, last);
+    }
+
+    /// Release the memory of elements, `clear` keeps the capacity.
+    template <typename T>
+    static void release(std::vector<T>& elements) {
+        std::vector<T>().swap(elements);
+    }
+
+    /// Insert the deduplicated occurrences and relations into indices, the vectors of each
+    /// file are released once they are inserted.
+    void flush() {
+        for(auto& [fid, file]: files) {
+            auto& index = *file.index;
+
+            deduplicate(file.occurrences, [](const std::pair<LocalSourceRange, SymbolID>& e) {
+                return std::tuple(e.first.begin, e.first.end, e.second);
+            });
+
+            std::size_t ranges_count = 0;
+            for(std::size_t i = 0; i < file.occurrences.size(); ++i) {
+                if(i == 0 || file.occurrences[i - 1].first != file.occurrences[i].first) {
+                    ranges_count += 1;
+                }
+            }
+
+            index.occurrences.reserve(index.occurrences.size() + ranges_count);
+            for(auto& [range, symbol]: file.occurrences) {
+                index.add_occurrence(range, symbol);
+            }
+            release(file.occurrences);
+
+            /// Keep the same equality with `DenseMapInfo<Relation>`.
+            deduplicate(file.relations, [](const std::pair<SymbolID, Relation>& element) {
+                auto& [symbol, relation] = element;
+                return std::tuple(symbol,
+                                  relation.kind.value(),
+                                  relation.range.begin,
+                                  relation.range.end,
+                                  relation.target_symbol);
+            });
+
+            for(std::size_t i = 0; i < file.relations.size();) {
+                auto id = file.relations[i].first;
+                auto end = i;
+                while(end < file.relations.size() && file.relations[end].first == id) {
+                    end += 1;
+                }
+
+                auto& symbol = index.get_symbol(id);
+                symbol.relations.reserve(symbol.relations.size() + (end - i));
+                for(; i < end; ++i) {
+                    index.add_relation(symbol, file.relations[i].second);
+                }
+            }
+            release(file.relations);
+        }
+
+        files.clear();
+        last_file = nullptr;
+    }
+
     void handleDeclOccurrence(const clang::NamedDecl* decl,
                               RelationKind kind,
                               clang::SourceLocation location) {
@@ -53,11 +158,32 @@ public:
         }
 
         auto [fid, range] = unit.decompose_range(location);
-        auto& index = getIndex(fid);
+        auto& file = getFile(fid);
         auto symbol_id = unit.getSymbolID(decl);
-        auto& symbol = index.get_symbol(symbol_id.hash);
+        auto& symbol = file.index->get_symbol(symbol_id.hash);
         symbol.kind = SymbolKind::from(decl);
-        index.add_occurrence(range, symbol_id.hash);
+        if(symbol.name.empty()) {
+            fill_symbol(symbol, decl);
+        }
+        add_occurrence(file, range, symbol_id.hash);
+    }
+
+    /// Fill the name and visibility of the symbol, which are the same for all its occurrences.
+    void fill_symbol(Symbol& symbol, const clang::NamedDecl* decl) {
+        symbol.name = ast::name_of(decl);
+        symbol.is_tu_local = !decl->isExternallyVisible();
+        symbol.is_function_local = decl->getParentFunctionOrMethod() != nullptr;
+
+        auto context = decl->getDeclContext()->getRedeclContext();
+        while(context->isInlineNamespace()) {
+            context = context->getParent()->getRedeclContext();
+        }
+
+        if(auto named = llvm::dyn_cast<clang::NamedDecl>(context)) {
+            llvm::raw_string_ostream os(symbol.scope);
+            named->printQualifiedName(os);
+            os << "::";
+        }
     }
 
     void handleMacroOccurrence(const clang::MacroInfo* def,
@@ -69,12 +195,14 @@ public:
         }
 
         auto [fid, range] = unit.decompose_range(location);
-        auto& index = getIndex(fid);
+        auto& file = getFile(fid);
         auto symbol_id = unit.getSymbolID(def);
-        auto& symbol = index.get_symbol(symbol_id.hash);
+        auto& symbol = file.index->get_symbol(symbol_id.hash);
         symbol.kind = SymbolKind::Macro;
-        symbol.name = unit.token_spelling(def->getDefinitionLoc());
-        index.add_occurrence(range, symbol_id.hash);
+        if(symbol.name.empty()) {
+            symbol.name = std::move(symbol_id.name);
+        }
+        add_occurrence(file, range, symbol_id.hash);
 
         if(kind & RelationKind::Definition) {
             auto begin = def->getDefinitionLoc();
@@ -84,19 +212,21 @@ public:
             assert(fid == fid2 && "Invalid macro definition location");
             /// definitionLoc = builder.getLocation(range);
 
-            index.add_relation(symbol,
-                               Relation{
-                                   .kind = RelationKind::Definition,
-                                   .range = range,
-                                   .definition_range = definition_range,
-                               });
+            add_relation(file,
+                         symbol_id.hash,
+                         Relation{
+                             .kind = RelationKind::Definition,
+                             .range = range,
+                             .definition_range = definition_range,
+                         });
         } else {
-            index.add_relation(symbol,
-                               Relation{
-                                   .kind = RelationKind::Reference,
-                                   .range = range,
-                                   .target_symbol = 0,
-                               });
+            add_relation(file,
+                         symbol_id.hash,
+                         Relation{
+                             .kind = RelationKind::Reference,
+                             .range = range,
+                             .target_symbol = 0,
+                         });
         }
     }
 
@@ -127,11 +257,17 @@ public:
             std::unreachable();
         }
 
-        auto& index = getIndex(fid);
+        auto& file = getFile(fid);
         auto symbol_id = unit.getSymbolID(ast::normalize(decl));
-        auto& symbol = index.get_symbol(symbol_id.hash);
-        index.add_relation(symbol, relation);
+        add_relation(file, symbol_id.hash, relation);
     }
+
+private:
+    llvm::DenseMap<clang::FileID, File> files;
+
+    clang::FileID last_fid;
+
+    File* last_file = nullptr;
 };
 
 }  // namespace
@@ -139,6 +275,7 @@ public:
 Indices index(CompilationUnit& unit) {
     IndexBuilder builder(unit);
     builder.run();
+    builder.flush();
     return std::move(builder);
 }
 
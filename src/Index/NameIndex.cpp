@@ -0,0 +1,282 @@
+#include <algorithm>
+
+#include "Index/NameIndex.h"
+#include "Support/FuzzyMatcher.h"
+#include "llvm/ADT/StringExtras.h"
+
+namespace clice::index {
+
+namespace {
+
+/// Tokens are packed into 32 bits, the highest byte is the length of name prefix
+/// for prefix tokens, and zero for trigrams.
+std::uint32_t trigram(char a, char b, char c) {
+    return std::uint32_t(std::uint8_t(a)) << 16 | std::uint32_t(std::uint8_t(b)) << 8 |
+           std::uint32_t(std::uint8_t(c));
+}
+
+std::uint32_t prefix(llvm::StringRef chars) {
+    assert(!chars.empty() && chars.size() <= 2);
+    if(chars.size() == 1) {
+        return 1u << 24 | std::uint32_t(std::uint8_t(chars[0]));
+    }
+    return 2u << 24 | std::uint32_t(std::uint8_t(chars[0])) << 8 |
+           std::uint32_t(std::uint8_t(chars[1]));
+}
+
+/// Lowercase the text and drop all separators, return whether each character is a segment head.
+void normalize(llvm::StringRef text,
+               llvm::SmallVectorImpl<char>& chars,
+               llvm::SmallVectorImpl<bool>& heads) {
+    text = text.take_front(127);
+
+    llvm::SmallVector<CharRole, 32> roles(text.size());
+    calculate_roles(text, roles);
+
+    for(std::size_t i = 0; i < text.size(); ++i) {
+        if(roles[i] == CharRole::Separator) {
+            continue;
+        }
+        chars.push_back(llvm::toLower(text[i]));
+        heads.push_back(roles[i] == CharRole::Head);
+    }
+}
+
+}  // namespace
+
+void NameIndex::tokenize(llvm::StringRef name, llvm::SmallVectorImpl<std::uint32_t>& tokens) {
+    llvm::SmallString<32> chars;
+    llvm::SmallVector<bool, 32> heads;
+    normalize(name, chars, heads);
+
+    auto n = chars.size();
+    if(n == 0) {
+        return;
+    }
+
+    /// The next segment head after each character.
+    llvm::SmallVector<std::size_t, 32> next_heads(n, n);
+    for(std::size_t i = n - 1; i > 0; --i) {
+        next_heads[i - 1] = heads[i] ? i : next_heads[i];
+    }
+
+    /// Short queries match the first character and the following character
+    /// or segment head, e.g. `u`, `un` and `up` for `unique_ptr`.
+    char first[] = {chars[0], 0};
+    tokens.push_back(prefix(llvm::StringRef(first, 1)));
+    for(auto j: {std::size_t(1), next_heads[0]}) {
+        if(j < n) {
+            first[1] = chars[j];
+            tokens.push_back(prefix(llvm::StringRef(first, 2)));
+        }
+    }
+
+    /// Like clangd, a trigram is formed by three characters, each of them is followed
+    /// by the next character or the next segment head, e.g. `u_p` and `ptr` for
+    /// `unique_ptr`, so that both consecutive and abbreviated queries could be found.
+    for(std::size_t i = 0; i < n; ++i) {
+        for(auto j: {i + 1, next_heads[i]}) {
+            if(j >= n) {
+                continue;
+            }
+
+            for(auto k: {j + 1, next_heads[j]}) {
+                if(k < n) {
+                    tokens.push_back(trigram(chars[i], chars[j], chars[k]));
+                }
+            }
+        }
+    }
+
+    std::ranges::sort(tokens);
+    tokens.erase(std::unique(tokens.begin(), tokens.end()), tokens.end());
+}
+
+void NameIndex::insert(std::uint32_t id) {
+    auto& entry = entries[id];
+    entry.char_set = FuzzyMatcher::char_set(entry.symbol.name);
+
+    llvm::SmallVector<std::uint32_t, 64> tokens;
+    tokenize(entry.symbol.name, tokens);
+    for(auto token: tokens) {
+        postings[token].push_back(id);
+    }
+}
+
+void NameIndex::update(llvm::StringRef file, std::uint64_t hash, std::vector<Symbol> symbols) {
+    auto [it, success] = file_ids.try_emplace(file, files.size());
+    if(success) {
+        files.emplace_back(file);
+    }
+
+    auto file_id = it->second;
+    if(auto hash_it = file_hashes.find(file_id);
+       hash_it != file_hashes.end() && hash_it->second == hash) {
+        return;
+    }
+
+    remove(file);
+    file_hashes[file_id] = hash;
+    auto& ids = file_entries[file_id];
+    for(auto& symbol: symbols) {
+        std::uint32_t id = entries.size();
+        entries.emplace_back(Entry{std::move(symbol), file_id});
+        ids.push_back(id);
+        insert(id);
+    }
+}
+
+bool NameIndex::contains(llvm::StringRef file, std::uint64_t hash) const {
+    auto it = file_ids.find(file);
+    if(it == file_ids.end()) {
+        return false;
+    }
+
+    auto hash_it = file_hashes.find(it->second);
+    return hash_it != file_hashes.end() && hash_it->second == hash;
+}
+
+void NameIndex::remove(llvm::StringRef file) {
+    auto it = file_ids.find(file);
+    if(it == file_ids.end()) {
+        return;
+    }
+
+    file_hashes.erase(it->second);
+
+    auto entry = file_entries.find(it->second);
+    if(entry == file_entries.end()) {
+        return;
+    }
+
+    for(auto id: entry->second) {
+        entries[id].removed = true;
+    }
+    removed += entry->second.size();
+    file_entries.erase(entry);
+
+    /// Removed entries are only skipped in query, reclaim them if they
+    /// take the most part of the table.
+    if(removed > 1024 && removed * 2 > entries.size()) {
+        compact();
+    }
+}
+
+void NameIndex::compact() {
+    std::vector<Entry> alives;
+    alives.reserve(entries.size() - removed);
+    for(auto& entry: entries) {
+        if(!entry.removed) {
+            alives.emplace_back(std::move(entry));
+        }
+    }
+
+    entries = std::move(alives);
+    removed = 0;
+    file_entries.clear();
+    postings.clear();
+
+    for(std::uint32_t id = 0; id < entries.size(); ++id) {
+        file_entries[entries[id].file].push_back(id);
+        insert(id);
+    }
+}
+
+auto NameIndex::query(llvm::StringRef pattern, std::size_t limit) const -> std::vector<Result> {
+    llvm::SmallString<32> chars;
+    llvm::SmallVector<bool, 32> heads;
+    normalize(pattern, chars, heads);
+
+    /// Short query only matches the name prefix, otherwise every trigram
+    /// of query must occur in the name.
+    llvm::SmallVector<std::uint32_t> tokens;
+    if(chars.empty()) {
+        return {};
+    } else if(chars.size() <= 2) {
+        tokens.push_back(prefix(chars));
+    } else {
+        for(std::size_t i = 0; i + 2 < chars.size(); ++i) {
+            tokens.push_back(trigram(chars[i], chars[i + 1], chars[i + 2]));
+        }
+    }
+
+    llvm::SmallVector<const std::vector<std::uint32_t>*> lists;
+    for(auto token: tokens) {
+        auto it = postings.find(token);
+        if(it == postings.end()) {
+            return {};
+        }
+        lists.push_back(&it->second);
+    }
+
+    /// Intersect from the shortest posting list, so that the candidates shrink quickly.
+    std::ranges::sort(lists, {}, [](auto list) { return list->size(); });
+
+    const std::vector<std::uint32_t>* candidates = lists.front();
+    std::vector<std::uint32_t> intersection;
+    std::vector<std::uint32_t> buffer;
+    for(auto list: llvm::drop_begin(lists)) {
+        buffer.clear();
+        std::ranges::set_intersection(*candidates, *list, std::back_inserter(buffer));
+        std::swap(intersection, buffer);
+        candidates = &intersection;
+        if(candidates->empty()) {
+            return {};
+        }
+    }
+
+    /// Only keep the best `limit` candidates with a min heap, the top of heap
+    /// is the worst one among them.
+    using Scored = std::pair<float, std::uint32_t>;
+    auto better = [&](const Scored& lhs, const Scored& rhs) {
+        if(lhs.first != rhs.first) {
+            return lhs.first > rhs.first;
+        }
+        /// Prefer shorter name if scores are equal.
+        return entries[lhs.second].symbol.name.size() < entries[rhs.second].symbol.name.size();
+    };
+
+    /// Like clangd, the count of scored candidates is bounded, so that a short query
+    /// doesn't score the most part of names.
+    std::size_t scored = 0;
+    auto max_scored = limit == 0 ? candidates->size() : limit * 100;
+
+    std::vector<Scored> heap;
+    FuzzyMatcher matcher(pattern);
+    for(auto id: *candidates) {
+        if(scored++ == max_scored) {
+            break;
+        }
+
+        auto& entry = entries[id];
+        if(entry.removed || !matcher.may_match(entry.char_set)) {
+            continue;
+        }
+
+        auto score = matcher.match(entry.symbol.name);
+        if(!score) {
+            continue;
+        }
+
+        if(limit == 0 || heap.size() < limit) {
+            heap.emplace_back(*score, id);
+            std::ranges::push_heap(heap, better);
+        } else if(better({*score, id}, heap.front())) {
+            std::ranges::pop_heap(heap, better);
+            heap.back() = {*score, id};
+            std::ranges::push_heap(heap, better);
+        }
+    }
+
+    std::ranges::sort_heap(heap, better);
+
+    std::vector<Result> results;
+    results.reserve(heap.size());
+    for(auto& [score, id]: heap) {
+        auto& entry = entries[id];
+        results.emplace_back(&entry.symbol, files[entry.file], score);
+    }
+    return results;
+}
+
+}  // namespace clice::index
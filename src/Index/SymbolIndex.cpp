@@ -0,0 +1,439 @@
+#include "Compiler/CompilationUnit.h"
+#include "Index/Index.h"
+#include "Index/SymbolIndex.h"
+#include "Support/Binary.h"
+#include "Support/Format.h"
+#include "Support/LineTable.h"
+#include "Support/Ranges.h"
+#include "llvm/Support/xxhash.h"
+
+namespace clice::index {
+
+namespace layout {
+
+/// Increase it when the layout of `SymbolIndex` is changed.
+constexpr std::uint32_t SymbolIndexVersion = 3;
+
+struct Relation {
+    RelationKind kind;
+
+    LocalSourceRange range;
+
+    /// The definition range, only valid for declaration and definition.
+    LocalSourceRange definition;
+
+    /// The hash of target symbol id, only valid for relations between symbols and calls.
+    std::uint64_t target;
+};
+
+struct Symbol {
+    std::uint64_t hash;
+
+    SymbolKind kind;
+
+    std::string name;
+
+    std::string scope;
+
+    bool is_tu_local;
+
+    bool is_function_local;
+
+    std::vector<Relation> relations;
+};
+
+struct Occurrence {
+    LocalSourceRange range;
+
+    /// The index of target symbol in `symbols`.
+    std::uint32_t symbol;
+};
+
+struct Include {
+    std::string path;
+
+    std::uint64_t hash;
+};
+
+struct SymbolIndex {
+    /// The version of layout.
+    std::uint32_t version = SymbolIndexVersion;
+
+    /// The path of source file.
+    std::string path;
+
+    /// The content of source file.
+    std::string content;
+
+    /// The hash of content, used to check whether the index is outdated.
+    std::uint64_t hash;
+
+    /// The hash of compile arguments, only valid for translation units.
+    std::uint64_t arguments;
+
+    /// All files included by the translation unit, sorted by path.
+    std::vector<Include> includes;
+
+    /// All symbols, sorted by the hash of symbol id.
+    std::vector<Symbol> symbols;
+
+    /// All occurrences, sorted by range.
+    std::vector<Occurrence> occurrences;
+};
+
+}  // namespace layout
+
+namespace {
+
+using Root = binary::Proxy<layout::SymbolIndex>;
+
+template <typename View, typename T>
+LazyArray<View> lazy_array(binary::Proxy<std::vector<T>> proxy) {
+    auto [offset, size] = proxy.value();
+    return LazyArray<View>(proxy.base,
+                           static_cast<const char*>(proxy.base) + offset,
+                           size,
+                           sizeof(binary::binarify_t<T>));
+}
+
+/// Binary search the symbol with given hash in the index starting at `base`.
+std::optional<Symbol> find_symbol(const void* base, std::uint64_t hash) {
+    auto symbols = Root{base, base}.get<"symbols">().as_array();
+    auto it = ranges::lower_bound(symbols, hash, {}, [&](const auto& symbol) {
+        return std::get<0>(symbol);
+    });
+
+    if(it == symbols.end() || std::get<0>(*it) != hash) {
+        return std::nullopt;
+    }
+    return Symbol{base, &*it};
+}
+
+}  // namespace
+
+RelationKind Relation::kind() const {
+    return static_cast<const layout::Relation*>(data)->kind;
+}
+
+LocalSourceRange Relation::range() const {
+    return static_cast<const layout::Relation*>(data)->range;
+}
+
+LocalSourceRange Relation::sourceRange() const {
+    return static_cast<const layout::Relation*>(data)->definition;
+}
+
+std::uint64_t Relation::target_hash() const {
+    return static_cast<const layout::Relation*>(data)->target;
+}
+
+std::optional<Symbol> Relation::target() const {
+    return find_symbol(base, target_hash());
+}
+
+SymbolID Symbol::id() const {
+    return SymbolID{hash(), name().str()};
+}
+
+std::uint64_t Symbol::hash() const {
+    return binary::Proxy<layout::Symbol>{base, data}.get<"hash">().value();
+}
+
+llvm::StringRef Symbol::name() const {
+    return binary::Proxy<layout::Symbol>{base, data}.get<"name">().as_string();
+}
+
+llvm::StringRef Symbol::scope() const {
+    return binary::Proxy<layout::Symbol>{base, data}.get<"scope">().as_string();
+}
+
+bool Symbol::is_tu_local() const {
+    return binary::Proxy<layout::Symbol>{base, data}.get<"is_tu_local">().value();
+}
+
+bool Symbol::is_function_local() const {
+    return binary::Proxy<layout::Symbol>{base, data}.get<"is_function_local">().value();
+}
+
+SymbolKind Symbol::kind() const {
+    return binary::Proxy<layout::Symbol>{base, data}.get<"kind">().value();
+}
+
+LazyArray<Relation> Symbol::relations() const {
+    binary::Proxy<layout::Symbol> symbol{base, data};
+    return lazy_array<Relation>(symbol.get<"relations">());
+}
+
+LocalSourceRange Occurrence::range() const {
+    return static_cast<const layout::Occurrence*>(data)->range;
+}
+
+Symbol Occurrence::symbol() const {
+    auto symbols = Root{base, base}.get<"symbols">();
+    auto index = static_cast<const layout::Occurrence*>(data)->symbol;
+    return Symbol{base, &symbols.as_array()[index]};
+}
+
+llvm::StringRef Include::path() const {
+    return binary::Proxy<layout::Include>{base, data}.get<"path">().as_string();
+}
+
+std::uint64_t Include::hash() const {
+    return binary::Proxy<layout::Include>{base, data}.get<"hash">().value();
+}
+
+std::optional<SymbolIndex> SymbolIndex::load(llvm::StringRef file) {
+    auto buffer = llvm::MemoryBuffer::getFile(file,
+                                              /*IsText=*/false,
+                                              /*RequiresNullTerminator=*/false);
+    if(!buffer) {
+        return std::nullopt;
+    }
+
+    auto size = buffer.get()->getBufferSize();
+    if(size < sizeof(binary::binarify_t<layout::SymbolIndex>)) {
+        return std::nullopt;
+    }
+
+    auto base = buffer.get()->getBufferStart();
+    Root index{base, base};
+    if(index.get<"version">().value() != layout::SymbolIndexVersion ||
+       !binary::validate(index, size)) {
+        return std::nullopt;
+    }
+
+    SymbolIndex result(base, size);
+    result.buffer = std::move(buffer.get());
+    return result;
+}
+
+SymbolIndex SymbolIndex::from(llvm::ArrayRef<char> buffer) {
+    std::shared_ptr<llvm::MemoryBuffer> copy =
+        llvm::MemoryBuffer::getMemBufferCopy(llvm::StringRef(buffer.data(), buffer.size()));
+    SymbolIndex result(copy->getBufferStart(), copy->getBufferSize());
+    result.buffer = std::move(copy);
+    return result;
+}
+
+llvm::StringRef SymbolIndex::path() const {
+    return Root{data, data}.get<"path">().as_string();
+}
+
+llvm::StringRef SymbolIndex::content() const {
+    return Root{data, data}.get<"content">().as_string();
+}
+
+std::uint64_t SymbolIndex::hash() const {
+    return Root{data, data}.get<"hash">().value();
+}
+
+std::uint64_t SymbolIndex::arguments_hash() const {
+    return Root{data, data}.get<"arguments">().value();
+}
+
+LazyArray<Include> SymbolIndex::includes() const {
+    return lazy_array<Include>(Root{data, data}.get<"includes">());
+}
+
+LazyArray<Symbol> SymbolIndex::symbols() const {
+    return lazy_array<Symbol>(Root{data, data}.get<"symbols">());
+}
+
+LazyArray<Occurrence> SymbolIndex::occurrences() const {
+    return lazy_array<Occurrence>(Root{data, data}.get<"occurrences">());
+}
+
+std::vector<Symbol> SymbolIndex::locateSymbol(uint32_t offset) const {
+    /// Occurrences don't overlap unless they have the same range, so only the
+    /// ones with the last range beginning before the offset could contain it.
+    auto occurrences = Root{data, data}.get<"occurrences">().as_array();
+    auto last = ranges::partition_point(occurrences, [&](const layout::Occurrence& occurrence) {
+        return occurrence.range.begin <= offset;
+    });
+
+    std::vector<Symbol> result;
+    if(last == occurrences.begin()) {
+        return result;
+    }
+
+    auto range = std::prev(last)->range;
+    for(auto it = std::prev(last); it->range == range; --it) {
+        if(range.contains(offset)) {
+            result.emplace_back(Occurrence{data, &*it}.symbol());
+        }
+
+        if(it == occurrences.begin()) {
+            break;
+        }
+    }
+
+    return result;
+}
+
+std::optional<Symbol> SymbolIndex::locateSymbol(const SymbolID& id) const {
+    return locateSymbol(id.hash);
+}
+
+std::optional<Symbol> SymbolIndex::locateSymbol(std::uint64_t hash) const {
+    return find_symbol(data, hash);
+}
+
+std::vector<char> SymbolIndex::build(const memory::RawIndex& raw,
+                                     const Dependencies& dependencies) {
+    layout::SymbolIndex index;
+    index.path = raw.path;
+    index.content = raw.content;
+    index.hash = llvm::xxh3_64bits(raw.content);
+    index.arguments = dependencies.arguments;
+    for(auto& [path, hash]: dependencies.includes) {
+        index.includes.emplace_back(path, hash);
+    }
+    ranges::sort(index.includes, {}, &layout::Include::path);
+
+    for(auto& [id, symbol]: raw.symbols) {
+        auto& result = index.symbols.emplace_back();
+        result.hash = id;
+        result.kind = symbol.kind;
+        result.name = symbol.name;
+        result.scope = symbol.scope;
+        result.is_tu_local = symbol.is_tu_local;
+        result.is_function_local = symbol.is_function_local;
+
+        for(auto& relation: symbol.relations) {
+            RelationKind kind = relation.kind;
+            auto& back = result.relations.emplace_back(layout::Relation{
+                .kind = kind,
+                .range = relation.range,
+                .target = 0,
+            });
+
+            if(kind.isDeclOrDef()) {
+                back.definition = relation.definition_range;
+            } else {
+                back.target = relation.target_symbol;
+            }
+        }
+
+        /// The relations are stored in a hash set, sort them to make the output stable.
+        ranges::sort(result.relations, [](const auto& lhs, const auto& rhs) {
+            return std::tuple(lhs.range.begin, lhs.range.end, lhs.kind.value(), lhs.target) <
+                   std::tuple(rhs.range.begin, rhs.range.end, rhs.kind.value(), rhs.target);
+        });
+    }
+
+    ranges::sort(index.symbols, {}, &layout::Symbol::hash);
+
+    for(auto& [range, occurrences]: raw.occurrences) {
+        for(auto& occurrence: occurrences) {
+            auto it = ranges::lower_bound(index.symbols,
+                                          occurrence.target_symbol,
+                                          {},
+                                          &layout::Symbol::hash);
+            if(it == index.symbols.end() || it->hash != occurrence.target_symbol) {
+                continue;
+            }
+
+            index.occurrences.emplace_back(range,
+                                           static_cast<std::uint32_t>(it - index.symbols.begin()));
+        }
+    }
+
+    ranges::sort(index.occurrences, [](const auto& lhs, const auto& rhs) {
+        return std::tuple(lhs.range.begin, lhs.range.end, lhs.symbol) <
+               std::tuple(rhs.range.begin, rhs.range.end, rhs.symbol);
+    });
+
+    auto [buffer, _] = binary::serialize(index);
+    return std::move(buffer);
+}
+
+auto SymbolIndex::dependencies(CompilationUnit& unit, std::uint64_t arguments) -> Dependencies {
+    Dependencies dependencies{.arguments = arguments};
+    for(auto fid: unit.files()) {
+        /// FIXME: The files from PCH or module are skipped, they are not indexed.
+        if(fid < clang::FileID::getSentinel() || fid == unit.interested_file()) {
+            continue;
+        }
+
+        dependencies.includes.emplace_back(unit.file_path(fid).str(),
+                                           llvm::xxh3_64bits(unit.file_content(fid)));
+    }
+    return dependencies;
+}
+
+Shared<std::vector<char>> SymbolIndex::build(CompilationUnit& unit, std::uint64_t arguments) {
+    auto indices = memory::index(unit);
+
+    Shared<std::vector<char>> result;
+    result.try_emplace(unit.interested_file(),
+                       build(*indices.tu_index, dependencies(unit, arguments)));
+    for(auto& [fid, index]: indices.header_indices) {
+        result.try_emplace(fid, build(*index));
+    }
+    return result;
+}
+
+json::Value SymbolIndex::toJSON(bool line) {
+    /// Convert the offsets to `line:column` (both 1-based) for readability.
+    LineTable lines(this->content());
+
+    auto to_json = [&](LocalSourceRange range) -> json::Value {
+        if(!line) {
+            return json::Array{range.begin, range.end};
+        }
+
+        auto position = [&](std::uint32_t offset) {
+            auto [row, column] = lines.position(offset);
+            return std::format("{}:{}", row + 1, column + 1);
+        };
+        return json::Array{position(range.begin), position(range.end)};
+    };
+
+    json::Array symbols;
+    for(auto symbol: this->symbols()) {
+        json::Array relations;
+        for(auto relation: symbol.relations()) {
+            json::Object object{
+                {"kind",  relation.kind().name()  },
+                {"range", to_json(relation.range())},
+            };
+
+            if(relation.kind().isDeclOrDef()) {
+                object.try_emplace("definition", to_json(relation.sourceRange()));
+            } else if(auto target = relation.target()) {
+                object.try_emplace("target", target->name().str());
+            }
+
+            relations.emplace_back(std::move(object));
+        }
+
+        symbols.emplace_back(json::Object{
+            {"hash",      std::format("{:016x}", symbol.hash())},
+            {"name",      symbol.name().str()                  },
+            {"kind",      symbol.kind().name()                 },
+            {"relations", std::move(relations)                 },
+        });
+    }
+
+    json::Array includes;
+    for(auto include: this->includes()) {
+        includes.emplace_back(include.path().str());
+    }
+
+    json::Array occurrences;
+    for(auto occurrence: this->occurrences()) {
+        occurrences.emplace_back(json::Object{
+            {"range",  to_json(occurrence.range())     },
+            {"symbol", occurrence.symbol().name().str()},
+        });
+    }
+
+    return json::Object{
+        {"path",        path().str()          },
+        {"includes",    std::move(includes)   },
+        {"symbols",     std::move(symbols)    },
+        {"occurrences", std::move(occurrences)},
+    };
+}
+
+}  // namespace clice::index
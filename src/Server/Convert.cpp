@@ -6,10 +6,9 @@
 
 namespace clice::proto {
 
-json::Value to_json(clice::PositionEncodingKind kind,
-                    llvm::StringRef content,
-                    llvm::ArrayRef<feature::SemanticToken> tokens) {
-    std::vector<std::uint32_t> groups;
+std::vector<uinteger> to_semantic_tokens(const PositionConverter& converter,
+                                         llvm::ArrayRef<feature::SemanticToken> tokens) {
+    std::vector<uinteger> groups;
 
     auto add_token = [&](uint32_t line,
                          uint32_t character,
@@ -23,7 +22,8 @@ json::Value to_json(clice::PositionEncodingKind kind,
         groups.emplace_back(0);
     };
 
-    PositionConverter converter(content, kind);
+    auto content = converter.content();
+    auto kind = converter.encoding();
     std::uint32_t last_line = 0;
     std::uint32_t last_char = 0;
 
@@ -83,19 +83,58 @@ json::Value to_json(clice::PositionEncodingKind kind,
         last_char = begin_char;
     }
 
-    auto object = json::Object{
-        /// The actual tokens.
-        {"data", json::serialize(groups)}
-    };
-    return json::Value(std::move(object));
+    return groups;
 }
 
-json::Value to_json(clice::PositionEncodingKind kind,
-                    llvm::StringRef content,
-                    llvm::ArrayRef<feature::CompletionItem> items) {
-    PositionConverter converter(content, kind);
-    converter.to_positions(items, [](auto& item) { return item.edit.range; });
+std::vector<uinteger> slice_semantic_tokens(llvm::ArrayRef<uinteger> data,
+                                            uinteger begin_line,
+                                            uinteger end_line) {
+    std::vector<uinteger> result;
+    uinteger line = 0;
+    uinteger character = 0;
+    for(std::size_t i = 0; i + 5 <= data.size(); i += 5) {
+        line += data[i];
+        character = data[i] == 0 ? character + data[i + 1] : data[i + 1];
+        if(line < begin_line) {
+            continue;
+        } else if(line > end_line) {
+            break;
+        }
+
+        if(result.empty()) {
+            result.insert(result.end(), {line, character});
+        } else {
+            result.insert(result.end(), data.begin() + i, data.begin() + i + 2);
+        }
+        result.insert(result.end(), data.begin() + i + 2, data.begin() + i + 5);
+    }
+    return result;
+}
+
+SemanticTokensEdit diff_semantic_tokens(llvm::ArrayRef<uinteger> old,
+                                        llvm::ArrayRef<uinteger> now) {
+    std::size_t prefix = 0;
+    auto common = std::min(old.size(), now.size());
+    while(prefix < common && old[prefix] == now[prefix]) {
+        prefix += 1;
+    }
+
+    std::size_t suffix = 0;
+    while(suffix < common - prefix &&
+          old[old.size() - suffix - 1] == now[now.size() - suffix - 1]) {
+        suffix += 1;
+    }
 
+    SemanticTokensEdit edit;
+    edit.start = prefix;
+    edit.deleteCount = old.size() - prefix - suffix;
+    edit.data.assign(now.begin() + prefix, now.end() - suffix);
+    return edit;
+}
+
+json::Value to_json(const PositionConverter& converter,
+                    llvm::ArrayRef<feature::CompletionItem> items,
+                    bool incomplete) {
     json::Array result;
 
     for(auto& item: items) {
@@ -109,10 +148,25 @@ json::Value to_json(clice::PositionEncodingKind kind,
              }},
             {"sortText", std::format("{}", item.score)},
         };
+
+        if(!item.additional_edits.empty()) {
+            json::Array edits;
+            for(auto& edit: item.additional_edits) {
+                edits.emplace_back(json::Object{
+                    {"newText", edit.text},
+                    {"range", json::serialize(converter.lookup(edit.range))},
+                });
+            }
+            object.try_emplace("additionalTextEdits", std::move(edits));
+        }
+
         result.emplace_back(std::move(object));
     }
 
-    return json::Value(std::move(result));
+    return json::Object{
+        {"isIncomplete", incomplete       },
+        {"items",        std::move(result)},
+    };
 }
 
 }  // namespace clice::proto
@@ -171,6 +171,7 @@ bool check_pch_update(llvm::StringRef content,
 
 /// The actual PCH build task.
 async::Task<bool> build_pch_task(CompilationDatabase::LookupInfo& info,
+                                 Indexer& indexer,
                                  std::string cache_dir,
                                  std::shared_ptr<OpenFile> open_file,
                                  std::string path,
@@ -207,8 +208,9 @@ async::Task<bool> build_pch_task(CompilationDatabase::LookupInfo& info,
     PCHInfo pch;
     std::string message = std::move(command);  // reuse buffer
     std::vector<feature::DocumentLink> links;
+    index::memory::Indices indices;
 
-    bool success = co_await async::submit([&params, &pch, &message, &links] -> bool {
+    bool success = co_await async::submit([&params, &pch, &message, &links, &indices] -> bool {
         /// PCH file is written until destructing, Add a single block for it.
         auto unit = compile(params, pch);
         if(!unit) {
@@ -217,7 +219,10 @@ async::Task<bool> build_pch_task(CompilationDatabase::LookupInfo& info,
         }
 
         links = feature::document_links(*unit);
-        /// TODO: index PCH file, etc
+
+        /// Headers in preamble are loaded from PCH when building AST, so they
+        /// are only indexed here.
+        indices = index::memory::index(*unit);
         return true;
     });
 
@@ -231,6 +236,8 @@ async::Task<bool> build_pch_task(CompilationDatabase::LookupInfo& info,
 
     logging::info("Building PCH successfully for {}", path);
 
+    indexer.update_names(indices);
+
     /// Update the built PCH info.
     open_file->pch = std::move(pch);
     open_file->pch_includes = std::move(links);
@@ -275,6 +282,7 @@ async::Task<bool> Server::build_pch(std::string file, std::string content) {
 
     /// Schedule the new building task.
     task = build_pch_task(info,
+                          indexer,
                           config.project.cache_dir,
                           open_file,
                           file,
@@ -293,6 +301,7 @@ async::Task<bool> Server::build_pch(std::string file, std::string content) {
 
 async::Task<> Server::build_ast(std::string path, std::string content) {
     auto file = opening_files.get_or_add(path);
+    auto version = file->version;
 
     /// Try get the lock, the waiter on the lock will be resumed when
     /// guard is destroyed.
@@ -321,6 +330,16 @@ async::Task<> Server::build_ast(std::string path, std::string content) {
     file->diagnostics->clear();
     params.diagnostics = file->diagnostics;
 
+    /// Build the PCMs of imported modules.
+    if(!co_await module_graph.resolve(path, content, params.pcms)) {
+        logging::warn("Fail to build imported modules for {}", path);
+    }
+
+    file->modules.clear();
+    for(auto& entry: params.pcms) {
+        file->modules.emplace_back(entry.getKey());
+    }
+
     /// Check result
     auto ast = co_await async::submit([&] { return compile(params); });
     if(!ast) {
@@ -347,16 +366,47 @@ async::Task<> Server::build_ast(std::string path, std::string content) {
                         {"diagnostics", std::move(diagnostics)},
     });
 
-    /// FIXME: Index the source file.
-    /// co_await indexer.index(*ast);
-
     /// Update built AST info.
     file->ast = std::make_shared<CompilationUnit>(std::move(*ast));
+    file->features = nullptr;
+    file->symbols = std::nullopt;
 
     /// Dispose the task so that it will destroyed when task complete.
     file->ast_build_task.dispose();
 
     logging::info("Building AST successfully for {}", path);
+
+    /// Keep the AST alive even if it is replaced.
+    auto unit = file->ast;
+    {
+        auto released = std::move(guard);
+    }
+
+    /// The client usually requests these features right after a change, compute them
+    /// before indexing. Requests coming meanwhile wait for the result instead of
+    /// computing again, see `get_features`.
+    if(config.feature.precompute && co_await update_semantic_tokens(path, file)) {
+        if(config.feature.refresh && semantic_tokens_refresh) {
+            co_await request("workspace/semanticTokens/refresh", nullptr);
+        }
+    }
+
+    /// Indexing the whole unit is expensive, wait until the editing pauses. If the file is
+    /// changed meanwhile, the newer AST will be indexed instead.
+    co_await async::sleep(std::chrono::milliseconds(config.index.edit_delay));
+    if(file->version != version) {
+        co_return;
+    }
+
+    /// The indexer traverses the AST on the thread pool. Hold the lock like other requests
+    /// using the AST, because the declarations in PCH are deserialized lazily, which is not
+    /// thread safe.
+    auto index_guard = co_await file->ast_built_lock.try_lock();
+    if(file->ast != unit) {
+        co_return;
+    }
+
+    co_await indexer.index(*unit);
 }
 
 async::Task<std::shared_ptr<OpenFile>> Server::add_document(std::string path, std::string content) {
@@ -364,6 +414,14 @@ async::Task<std::shared_ptr<OpenFile>> Server::add_document(std::string path, st
     openFile->version += 1;
     openFile->content = content;
 
+    /// The features loaded from stored index are only valid for the indexed content.
+    if(openFile->features && !openFile->features->ast) {
+        openFile->features = nullptr;
+    }
+
+    /// The symbols are built from the AST of old content.
+    openFile->symbols = std::nullopt;
+
     auto& task = openFile->ast_build_task;
 
     /// If there is already an AST build task, cancel it.
@@ -399,7 +457,30 @@ async::Task<> Server::on_did_change(proto::DidChangeTextDocumentParams params) {
 
 async::Task<> Server::on_did_save(proto::DidSaveTextDocumentParams params) {
     auto path = mapping.to_path(params.textDocument.uri);
-    co_return;
+
+    /// Rebuild the PCMs affected by this file.
+    auto changed = co_await module_graph.update(path);
+    if(changed.empty()) {
+        co_return;
+    }
+
+    /// Rebuild the AST of opening files which import the modules whose interface changed.
+    llvm::StringSet<> changed_modules;
+    for(auto& name: changed) {
+        changed_modules.insert(name);
+    }
+
+    std::vector<std::pair<std::string, std::string>> outdated;
+    for(auto& [file, open_file]: opening_files) {
+        if(ranges::any_of(open_file->modules,
+                          [&](const std::string& name) { return changed_modules.contains(name); })) {
+            outdated.emplace_back(file.str(), open_file->content);
+        }
+    }
+
+    for(auto& [file, content]: outdated) {
+        co_await add_document(std::move(file), std::move(content));
+    }
 }
 
 async::Task<> Server::on_did_close(proto::DidCloseTextDocumentParams params) {
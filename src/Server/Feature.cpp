@@ -2,6 +2,7 @@
 #include "Server/Server.h"
 #include "Server/Convert.h"
 #include "Compiler/Compilation.h"
+#include "Compiler/Preamble.h"
 #include "Feature/CodeCompletion.h"
 #include "Feature/Hover.h"
 #include "Feature/SignatureHelp.h"
@@ -10,37 +11,543 @@
 #include "Feature/FoldingRange.h"
 #include "Feature/SemanticToken.h"
 #include "Feature/InlayHint.h"
+#include "Index/Index.h"
+#include "Support/Format.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/Support/xxhash.h"
+#include "clang/Frontend/CompilerInvocation.h"
 
 namespace clice {
 
+namespace {
+
+/// Check whether the cached completion could be reused, i.e. only the prefix is extended
+/// and the context (all other content and the preamble) is unchanged.
+bool is_reusable(const CompletionCache& cache,
+                 const CompletionSession& session,
+                 std::uint32_t start,
+                 std::uint32_t offset) {
+    if(cache.pch_mtime != session.pch_mtime || cache.start != start || offset < cache.offset) {
+        return false;
+    }
+
+    llvm::StringRef old_content = *cache.content;
+    llvm::StringRef new_content = *session.content;
+    if(new_content.size() != old_content.size() + (offset - cache.offset)) {
+        return false;
+    }
+
+    return new_content.starts_with(old_content.substr(0, cache.offset)) &&
+           new_content.substr(offset) == old_content.substr(cache.offset);
+}
+
+/// The max count of completion candidates from index.
+constexpr std::size_t MaxIndexCandidates = 100;
+
+/// The max count of symbols returned by `workspace/symbol`.
+constexpr std::size_t MaxWorkspaceSymbols = 100;
+
+/// Whether the identifier starting at `start` could be completed with the symbols from index,
+/// i.e. it is an unqualified name and is not in a preprocessor directive.
+bool is_global_completion(llvm::StringRef content, std::uint32_t start) {
+    auto before = content.substr(0, start);
+    auto line = before.substr(before.rfind('\n') + 1).ltrim();
+    if(line.starts_with("#")) {
+        return false;
+    }
+
+    before = before.rtrim();
+    return !before.ends_with(".") && !before.ends_with("->") && !before.ends_with("::");
+}
+
+/// Spell the header with the header search paths of invocation, e.g. `<vector>`. The
+/// search path which gives the shortest spelling is chosen. Return empty if the header
+/// is not reachable from any search path.
+std::string spell_header(const clang::CompilerInvocation& invocation,
+                         llvm::StringRef file,
+                         llvm::StringRef header) {
+    llvm::SmallString<256> target = header;
+    path::remove_dots(target, true);
+
+    std::string spelling;
+    std::size_t length = 0;
+
+    auto try_directory = [&](llvm::StringRef directory, bool angled) {
+        llvm::SmallString<256> dir = directory;
+        path::remove_dots(dir, true);
+
+        llvm::StringRef relative = target;
+        if(dir.empty() || dir.size() <= length || !relative.consume_front(dir) ||
+           relative.empty() || !path::is_separator(relative.front())) {
+            return;
+        }
+
+        length = dir.size();
+        auto name = path::convert_to_slash(relative.drop_front());
+        spelling = angled ? std::format("<{}>", name) : std::format("\"{}\"", name);
+    };
+
+    try_directory(path::parent_path(file), false);
+
+    for(auto& entry: invocation.getHeaderSearchOpts().UserEntries) {
+        if(entry.IsFramework) {
+            continue;
+        }
+
+        bool angled = entry.Group != clang::frontend::Quoted &&
+                      entry.Group != clang::frontend::Angled;
+        try_directory(entry.Path, angled);
+    }
+
+    return spelling;
+}
+
+/// Get the offset to insert a new `#include`, i.e. the beginning of line after the
+/// last `#include` in the preamble, or the beginning of file if there is none.
+std::uint32_t include_insertion_offset(llvm::StringRef content) {
+    auto preamble = content.substr(0, compute_preamble_bound(content));
+
+    std::uint32_t offset = 0;
+    std::uint32_t line_start = 0;
+    while(line_start < preamble.size()) {
+        auto line_end = preamble.find('\n', line_start);
+        if(line_end == llvm::StringRef::npos) {
+            line_end = preamble.size();
+        }
+
+        auto line = preamble.slice(line_start, line_end).ltrim();
+        if(line.consume_front("#")) {
+            line = line.ltrim();
+            if(line.starts_with("include") || line.starts_with("import")) {
+                offset = std::min<std::uint32_t>(line_end + 1, content.size());
+            }
+        }
+
+        line_start = line_end + 1;
+    }
+
+    return offset;
+}
+
+feature::CompletionItemKind completion_kind(SymbolKind kind) {
+    using Kind = feature::CompletionItemKind;
+    switch(kind.kind()) {
+        case SymbolKind::Macro: return Kind::Unit;
+        case SymbolKind::Namespace: return Kind::Module;
+        case SymbolKind::Class:
+        case SymbolKind::Union: return Kind::Class;
+        case SymbolKind::Struct: return Kind::Struct;
+        case SymbolKind::Enum: return Kind::Enum;
+        case SymbolKind::EnumMember: return Kind::EnumMember;
+        case SymbolKind::Function: return Kind::Function;
+        case SymbolKind::Variable: return Kind::Variable;
+        case SymbolKind::Type:
+        case SymbolKind::Concept: return Kind::TypeParameter;
+        default: return Kind::Text;
+    }
+}
+
+/// Complete the name with the symbols declared in indexed headers, which may be not included
+/// yet. For such symbols, the qualified name is inserted, and the missing `#include` is
+/// inserted with an additional edit. The result is incomplete if there are too many candidates.
+feature::CodeCompletionResult index_completion(const index::NameIndex& names,
+                                               const CompletionSession& session,
+                                               llvm::StringRef path,
+                                               LocalSourceRange range,
+                                               std::uint32_t offset) {
+    llvm::StringRef content = *session.content;
+    auto prefix = content.slice(range.begin, offset);
+    if(prefix.empty() || !session.invocation || !is_global_completion(content, range.begin)) {
+        return {};
+    }
+
+    feature::CodeCompletionResult completion;
+    std::optional<std::uint32_t> insertion;
+    llvm::StringMap<std::string> spellings;
+    llvm::StringSet<> visited;
+
+    auto results = names.query(prefix, MaxIndexCandidates);
+    completion.incomplete = results.size() == MaxIndexCandidates;
+
+    for(auto& result: results) {
+        auto& symbol = *result.symbol;
+        if(result.file == path) {
+            continue;
+        }
+
+        auto [it, success] = spellings.try_emplace(result.file);
+        if(success) {
+            it->second = spell_header(*session.invocation, path, result.file);
+        }
+
+        auto& spelling = it->second;
+        if(spelling.empty()) {
+            continue;
+        }
+
+        auto text = symbol.scope + symbol.name;
+        if(!visited.insert(text).second) {
+            continue;
+        }
+
+        feature::CompletionItem item;
+        item.label = symbol.name;
+        item.kind = completion_kind(symbol.kind);
+        /// Prefer the symbols which are already visible.
+        item.score = result.score * 0.5f;
+        item.deprecated = false;
+        item.edit.text = std::move(text);
+        item.edit.range = range;
+
+        auto directive = std::format("#include {}\n", spelling);
+        if(!content.contains(directive)) {
+            if(!insertion) {
+                insertion = include_insertion_offset(content);
+            }
+            item.additional_edits.emplace_back(std::move(directive),
+                                               LocalSourceRange{*insertion, *insertion});
+        }
+
+        completion.items.emplace_back(std::move(item));
+    }
+
+    return completion;
+}
+
+/// The rendered completion results, Sema results and index results are kept separately,
+/// so that they could be reported in order as partial results.
+struct RenderedCompletion {
+    /// The `CompletionList` of Sema results.
+    json::Value sema;
+
+    /// The `CompletionItem[]` of the index items whose name is not offered by Sema,
+    /// i.e. they are not visible in current file.
+    json::Array index;
+};
+
+RenderedCompletion render_completion(PositionEncodingKind kind,
+                                     llvm::StringRef content,
+                                     llvm::ArrayRef<feature::CompletionItem> items,
+                                     feature::CodeCompletionResult& index,
+                                     bool incomplete) {
+    RenderedCompletion result;
+    PositionConverter converter(content, kind);
+    result.sema = proto::to_json(converter, items, incomplete || index.incomplete);
+    if(index.items.empty()) {
+        return result;
+    }
+
+    llvm::StringSet<> labels;
+    for(auto& item: items) {
+        labels.insert(item.label);
+    }
+
+    std::erase_if(index.items, [&](auto& item) { return labels.contains(item.label); });
+    auto list = proto::to_json(converter, index.items);
+    result.index = std::move(*list.getAsObject()->getArray("items"));
+    return result;
+}
+
+/// A symbol in the call or type hierarchy, located by its definition in the stored indices.
+struct HierarchyEntry {
+    /// The index containing the definition, or a declaration if the symbol is not defined
+    /// in any indexed file.
+    index::SymbolIndex index;
+
+    std::uint64_t hash;
+
+    std::string name;
+
+    SymbolKind kind;
+
+    /// Whether the entry is located by the definition.
+    bool is_definition;
+
+    /// The range of the name and the whole declaration.
+    LocalSourceRange selection;
+    LocalSourceRange range;
+
+    /// The index containing the calls and the ranges of them, only for call hierarchy.
+    std::optional<index::SymbolIndex> calls_index;
+    std::vector<LocalSourceRange> calls;
+};
+
+/// Find the definition of the symbol in the index, or a declaration if it isn't defined there.
+std::optional<HierarchyEntry> find_entry(const index::SymbolIndex& index, std::uint64_t hash) {
+    auto symbol = index.locateSymbol(hash);
+    if(!symbol) {
+        return std::nullopt;
+    }
+
+    std::optional<index::Relation> found;
+    for(auto relation: symbol->relations()) {
+        if(relation.kind() & RelationKind::Definition) {
+            found = relation;
+            break;
+        }
+
+        if(!found && (relation.kind() & RelationKind::Declaration)) {
+            found = relation;
+        }
+    }
+
+    if(!found) {
+        return std::nullopt;
+    }
+
+    return HierarchyEntry{
+        .index = index,
+        .hash = hash,
+        .name = symbol->name().str(),
+        .kind = symbol->kind(),
+        .is_definition = bool(found->kind() & RelationKind::Definition),
+        .selection = found->range(),
+        .range = found->sourceRange(),
+        .calls_index = std::nullopt,
+        .calls = {},
+    };
+}
+
+/// Locate the symbol in all indexed files, `find` returns the indices containing it. The index
+/// of `hint` is searched first, it usually contains the definition already, e.g. the caller
+/// is defined in the file of the call.
+template <typename Find>
+async::Task<std::optional<HierarchyEntry>> locate_entry(Find find,
+                                                        std::uint64_t hash,
+                                                        const index::SymbolIndex* hint) {
+    std::optional<HierarchyEntry> declaration;
+    if(hint) {
+        declaration = find_entry(*hint, hash);
+        if(declaration && declaration->is_definition) {
+            co_return declaration;
+        }
+    }
+
+    auto files = co_await find(hash);
+    for(auto& file: files) {
+        auto entry = find_entry(file, hash);
+        if(entry && entry->is_definition) {
+            co_return entry;
+        }
+
+        if(!declaration) {
+            declaration = std::move(entry);
+        }
+    }
+
+    co_return declaration;
+}
+
+/// The hash of symbol id is stored in the `data` of hierarchy item.
+std::optional<std::uint64_t> item_hash(llvm::StringRef data) {
+    std::uint64_t hash;
+    if(data.getAsInteger(10, hash)) {
+        return std::nullopt;
+    }
+    return hash;
+}
+
+/// Convert the entries to hierarchy items, the line tables are shared by the same file
+/// contents. An opened file may have both the stored index and the one built from its
+/// current AST, so the content hash is a part of the key.
+class HierarchyConverter {
+public:
+    HierarchyConverter(PathMapping& mapping, PositionEncodingKind kind) :
+        mapping(mapping), kind(kind) {}
+
+    const PositionConverter& positions(const index::SymbolIndex& index) {
+        auto key = std::format("{}:{}", index.hash(), index.path());
+        auto it = converters.find(key);
+        if(it == converters.end()) {
+            it = converters.try_emplace(key, index.content(), kind).first;
+        }
+        return it->second;
+    }
+
+    proto::CallHierarchyItem item(const HierarchyEntry& entry) {
+        auto& positions = this->positions(entry.index);
+        return proto::CallHierarchyItem{
+            .name = entry.name,
+            .kind = proto::kind_map(entry.kind),
+            .uri = mapping.to_uri(entry.index.path()),
+            .range = positions.lookup(entry.range),
+            .selectionRange = positions.lookup(entry.selection),
+            .data = std::to_string(entry.hash),
+        };
+    }
+
+private:
+    PathMapping& mapping;
+    PositionEncodingKind kind;
+    llvm::StringMap<PositionConverter> converters;
+};
+
+}  // namespace
+
+async::Task<std::shared_ptr<CompletionSession>> Server::get_completion_session(
+    std::string path,
+    std::shared_ptr<OpenFile> file) {
+    if(!file->pch_build_task.empty()) {
+        co_await file->pch_built_event;
+    }
+
+    auto& pch = file->pch;
+    std::int64_t pch_mtime = pch ? pch->mtime : 0;
+
+    auto old = file->completion_session;
+    if(old && old->version == file->version && old->pch_mtime == pch_mtime) {
+        co_return old;
+    }
+
+    CommandOptions options;
+    options.resource_dir = true;
+    options.query_driver = true;
+
+    auto session = std::make_shared<CompletionSession>();
+    session->version = file->version;
+    session->content = std::make_shared<const std::string>(file->content);
+    session->arguments = database.get_command(path, options).arguments;
+
+    if(pch) {
+        session->pch = {pch->path, pch->preamble.size()};
+        session->pch_mtime = pch->mtime;
+    }
+
+    /// Resolve the imports from the current content rather than the modules of last AST, so
+    /// that the PCMs are available before the first building and are built on demand after
+    /// an `import` is edited.
+    co_await module_graph.resolve(path, *session->content, session->pcms);
+
+    /// The invocation only depends on the arguments, reuse it if possible.
+    if(old && old->arguments == session->arguments) {
+        session->invocation = old->invocation;
+    }
+
+    co_await async::submit([&session] {
+        session->lines = std::make_shared<const LineTable>(*session->content);
+        if(!session->invocation) {
+            CompilationParams params;
+            params.arguments = session->arguments;
+            session->invocation = prepare_invocation(params);
+        }
+    });
+
+    file->completion_session = session;
+    co_return session;
+}
+
+async::Task<json::Value> Server::report_completion(std::optional<json::Value> token,
+                                                   json::Value sema,
+                                                   json::Array index) {
+    if(!token) {
+        auto& items = *sema.getAsObject()->getArray("items");
+        for(auto& item: index) {
+            items.emplace_back(std::move(item));
+        }
+        co_return sema;
+    }
+
+    /// The first partial result is a `CompletionList` to carry `isIncomplete`, and
+    /// the following ones are arrays of items appended to it.
+    co_await notify("$/progress",
+                    json::Object{
+                        {"token", *token         },
+                        {"value", std::move(sema)},
+    });
+
+    if(!index.empty()) {
+        co_await notify("$/progress",
+                        json::Object{
+                            {"token", *token          },
+                            {"value", std::move(index)},
+        });
+    }
+
+    co_return json::Array();
+}
+
 auto Server::on_completion(proto::CompletionParams params) -> Result {
     auto path = mapping.to_path(params.textDocument.uri);
+    auto token = std::move(params.partialResultToken);
     auto opening_file = opening_files.get_or_add(path);
+    auto session = co_await get_completion_session(path, opening_file);
 
-    if(!opening_file->pch_build_task.empty()) {
-        co_await opening_file->pch_built_event;
-    }
-
-    auto& content = opening_file->content;
+    auto& content = *session->content;
     auto offset = to_offset(kind, content, params.position);
-    auto& pch = opening_file->pch;
-    {
-        CommandOptions options;
-        options.resource_dir = true;
+    auto range = feature::completion_prefix(content, offset);
+    auto start = range.begin;
+
+    /// If user continues typing the same identifier, filter the result
+    /// of last completion instead of running code completion again.
+    auto old_cache = opening_file->completion_cache;
+    bool reusable = old_cache && is_reusable(*old_cache, *session, start, offset);
+
+    std::shared_ptr<CompletionCache> cache;
+    std::vector<feature::CompletionItem> filtered;
+    bool incomplete = false;
+
+    auto complete = [&]() -> async::Task<> {
+        if(reusable) {
+            co_await async::submit([&content, &old_cache, &filtered, offset] {
+                filtered = feature::filter_completion(old_cache->items, content, offset);
+            });
+            co_return;
+        }
 
         /// Set compilation params ... .
         CompilationParams params;
         params.kind = CompilationUnit::Completion;
-        params.arguments = database.get_command(path).arguments;
-        params.add_remapped_file(path, content);
-        params.pch = {pch->path, pch->preamble.size()};
+        params.arguments = session->arguments;
+        params.invocation = session->invocation;
+        params.add_remapped_file_ref(path, content);
+        params.pch = session->pch;
+        params.pcms = session->pcms;
         params.completion = {path, offset};
+        params.line_table = session->lines;
+
+        cache = std::make_shared<CompletionCache>();
+        cache->start = start;
+        cache->offset = offset;
+        cache->content = session->content;
+        cache->pch_mtime = session->pch_mtime;
 
-        co_return co_await async::submit([kind = this->kind, &content, &params] {
-            auto items = feature::code_complete(params, {});
-            return proto::to_json(kind, content, items);
+        auto& option = config.completion;
+        co_await async::submit([&params, &option, &cache, &incomplete] {
+            auto completion = feature::code_complete(params, option);
+            incomplete = completion.incomplete;
+            cache->items = std::move(completion.items);
         });
+    };
+
+    feature::CodeCompletionResult index;
+
+    auto query = [&]() -> async::Task<> {
+        /// The name index is only updated in the main thread, query it here. The results
+        /// are not cached, since they are changed by indexing. They are reported after Sema
+        /// results, with the names offered by Sema removed, see `render_completion`.
+        index = index_completion(indexer.name_index(), *session, path, range, offset);
+        co_return;
+    };
+
+    /// Sema runs in the thread pool while the index is queried in the main thread.
+    co_await async::gather(complete(), query());
+
+    llvm::ArrayRef<feature::CompletionItem> items = reusable ? filtered : cache->items;
+    auto result = co_await async::submit([kind = this->kind, &content, items, &index, incomplete] {
+        return render_completion(kind, content, items, index, incomplete);
+    });
+
+    /// Some items are dropped in an incomplete result, it couldn't be filtered
+    /// for a longer prefix.
+    if(!reusable) {
+        opening_file->completion_cache = incomplete ? nullptr : std::move(cache);
     }
+
+    co_return co_await report_completion(std::move(token),
+                                         std::move(result.sema),
+                                         std::move(result.index));
 }
 
 auto Server::on_hover(proto::HoverParams params) -> Result {
@@ -73,61 +580,106 @@ auto Server::on_hover(proto::HoverParams params) -> Result {
 async::Task<json::Value> Server::on_signature_help(proto::SignatureHelpParams params) {
     auto path = mapping.to_path(params.textDocument.uri);
     auto opening_file = opening_files.get_or_add(path);
+    auto session = co_await get_completion_session(path, opening_file);
 
-    if(!opening_file->pch_build_task.empty()) {
-        co_await opening_file->pch_built_event;
-    }
-
-    auto& content = opening_file->content;
+    auto& content = *session->content;
     auto offset = to_offset(kind, content, params.position);
-    auto& pch = opening_file->pch;
     {
-        CommandOptions options;
-        options.resource_dir = true;
-
         /// Set compilation params ... .
         CompilationParams params;
         params.kind = CompilationUnit::Completion;
-        params.arguments = database.get_command(path, options).arguments;
-        params.add_remapped_file(path, content);
-        params.pch = {pch->path, pch->preamble.size()};
+        params.arguments = session->arguments;
+        params.invocation = session->invocation;
+        params.add_remapped_file_ref(path, content);
+        params.pch = session->pch;
+        params.pcms = session->pcms;
         params.completion = {path, offset};
+        params.line_table = session->lines;
 
-        co_return co_await async::submit([kind = this->kind, &content, &params] {
+        co_return co_await async::submit([&params] {
             auto help = feature::signature_help(params, {});
             return json::serialize(help);
         });
     }
 }
 
+async::Task<std::shared_ptr<FeatureCache>> Server::get_features(std::string path,
+                                                                std::shared_ptr<OpenFile> file) {
+    /// The AST is not built yet, the stored features could be used if the content is
+    /// not changed since indexing, so that the file is shown immediately.
+    if(!file->ast) {
+        if(file->features) {
+            co_return file->features;
+        }
+
+        if(auto index = indexer.load_features(path, file->content)) {
+            auto version = file->version;
+            auto cache = std::make_shared<FeatureCache>();
+            cache->index = std::move(index);
+            cache->content = cache->index->content();
+            cache->features = co_await async::submit([&cache] {
+                cache->lines = std::make_shared<LineTable>(cache->content);
+                auto& index = *cache->index;
+                return feature::FileFeatures{
+                    index.semanticTokens(),
+                    index.foldingRanges(),
+                    index.documentSymbols(),
+                    index.documentLinks(),
+                };
+            });
+
+            /// The AST may be built meanwhile. If the file is changed, the features are only
+            /// valid for the old content and they are not cached.
+            if(!file->ast && file->version == version) {
+                file->features = cache;
+            }
+            co_return cache;
+        }
+    }
+
+    auto version = file->version;
+
+    /// Hold the lock while computing, so that concurrent requests wait for the result.
+    auto guard = co_await file->ast_built_lock.try_lock();
+    auto ast = file->ast;
+
+    if(file->version != version || !ast) {
+        co_return nullptr;
+    }
+
+    if(file->features && file->features->ast == ast) {
+        co_return file->features;
+    }
+
+    auto cache = std::make_shared<FeatureCache>();
+    cache->ast = ast;
+    cache->content = ast->interested_content();
+    cache->features = co_await async::submit([&cache, &ast] {
+        cache->lines = std::make_shared<LineTable>(cache->content);
+        return feature::file_features(*ast);
+    });
+    file->features = cache;
+    co_return cache;
+}
+
 auto Server::on_document_symbol(proto::DocumentSymbolParams params) -> Result {
     auto path = mapping.to_path(params.textDocument.uri);
     auto opening_file = opening_files.get_or_add(path);
-    auto version = opening_file->version;
-
-    auto guard = co_await opening_file->ast_built_lock.try_lock();
-    auto ast = opening_file->ast;
 
-    if(opening_file->version != version || !ast) {
+    auto cache = co_await get_features(path, opening_file);
+    if(!cache) {
         co_return json::Value(nullptr);
     }
 
-    llvm::StringRef content = ast->interested_content();
-    auto to_range = [&](LocalSourceRange range) {
-        auto c = PositionConverter(content, kind);
-        auto begin = c.toPosition(range.begin);
-        auto end = c.toPosition(range.end);
-        return proto::Range{begin, end};
-    };
-
-    auto transform = [&to_range](this auto& self,
-                                 feature::DocumentSymbol& symbol) -> proto::DocumentSymbol {
+    PositionConverter converter(cache->lines, kind);
+    auto transform = [&converter](this auto& self,
+                                 const feature::DocumentSymbol& symbol) -> proto::DocumentSymbol {
         proto::DocumentSymbol result;
-        result.name = std::move(symbol.name);
-        result.detail = std::move(symbol.detail);
+        result.name = symbol.name;
+        result.detail = symbol.detail;
         result.kind = proto::kind_map(symbol.kind.kind());
-        result.range = to_range(symbol.range);
-        result.selectionRange = to_range(symbol.selectionRange);
+        result.range = converter.lookup(symbol.range);
+        result.selectionRange = converter.lookup(symbol.selectionRange);
 
         for(auto& child: symbol.children) {
             result.children.emplace_back(self(child));
@@ -136,11 +688,9 @@ auto Server::on_document_symbol(proto::DocumentSymbolParams params) -> Result {
         return result;
     };
 
-    co_return co_await async::submit([&ast, &transform] {
-        auto symbols = feature::document_symbols(*ast);
-
+    co_return co_await async::submit([&cache, &transform] {
         std::vector<proto::DocumentSymbol> result;
-        for(auto& symbol: symbols) {
+        for(auto& symbol: cache->features.document_symbols) {
             result.emplace_back(transform(symbol));
         }
 
@@ -151,28 +701,27 @@ auto Server::on_document_symbol(proto::DocumentSymbolParams params) -> Result {
 auto Server::on_document_link(proto::DocumentLinkParams params) -> Result {
     auto path = mapping.to_path(params.textDocument.uri);
     auto opening_file = opening_files.get_or_add(path);
-    auto version = opening_file->version;
 
-    auto guard = co_await opening_file->ast_built_lock.try_lock();
-    auto ast = opening_file->ast;
-
-    if(opening_file->version != version || !ast) {
+    auto cache = co_await get_features(path, opening_file);
+    if(!cache) {
         co_return json::Value(nullptr);
     }
 
-    auto pch_links = opening_file->pch_includes;
+    /// The stored index already contains the links in preamble.
+    std::vector<feature::DocumentLink> pch_links;
+    if(cache->ast) {
+        pch_links = opening_file->pch_includes;
+    }
     auto mapping = this->mapping;
 
     co_return co_await async::submit([&, kind = this->kind] {
-        auto links = feature::document_links(*ast);
-        links.insert(links.begin(), pch_links.begin(), pch_links.end());
+        auto& links = cache->features.document_links;
+        pch_links.insert(pch_links.end(), links.begin(), links.end());
 
-        llvm::StringRef content = ast->interested_content();
-        PositionConverter converter(content, kind);
-        converter.to_positions(links, [](feature::DocumentLink& link) { return link.range; });
+        PositionConverter converter(cache->lines, kind);
 
         std::vector<proto::DocumentLink> result;
-        for(auto& link: links) {
+        for(auto& link: pch_links) {
             result.emplace_back(converter.lookup(link.range), mapping.to_uri(link.file));
         }
         return json::serialize(result);
@@ -208,21 +757,15 @@ auto Server::on_document_range_format(proto::DocumentRangeFormattingParams param
 async::Task<json::Value> Server::on_folding_range(proto::FoldingRangeParams params) {
     auto path = mapping.to_path(params.textDocument.uri);
     auto opening_file = opening_files.get_or_add(path);
-    auto version = opening_file->version;
-
-    auto guard = co_await opening_file->ast_built_lock.try_lock();
-    auto ast = opening_file->ast;
 
-    if(opening_file->version != version || !ast) {
+    auto cache = co_await get_features(path, opening_file);
+    if(!cache) {
         co_return json::Value(nullptr);
     }
 
     co_return co_await async::submit([&, kind = this->kind] {
-        llvm::StringRef content = ast->interested_content();
-        auto foldings = feature::folding_ranges(*ast);
-        PositionConverter converter(content, kind);
-        converter.to_positions(foldings,
-                               [](feature::FoldingRange& folding) { return folding.range; });
+        auto& foldings = cache->features.folding_ranges;
+        PositionConverter converter(cache->lines, kind);
 
         std::vector<proto::FoldingRange> result;
 
@@ -245,22 +788,110 @@ async::Task<json::Value> Server::on_folding_range(proto::FoldingRangeParams para
     });
 }
 
+async::Task<bool> Server::update_semantic_tokens(std::string path,
+                                                 std::shared_ptr<OpenFile> file) {
+    auto features = co_await get_features(std::move(path), file);
+    if(!features) {
+        co_return false;
+    }
+
+    /// Compare the owners, so that new features at the same address are not mistaken.
+    auto& cache = file->semantic_tokens;
+    if(cache.data && !cache.features.owner_before(features) &&
+       !features.owner_before(cache.features)) {
+        co_return true;
+    }
+
+    auto data = co_await async::submit([kind = this->kind, &features] {
+        PositionConverter converter(features->lines, kind);
+        return proto::to_semantic_tokens(converter, features->features.semantic_tokens);
+    });
+
+    cache.features = features;
+    cache.id += 1;
+    cache.data = std::make_shared<const std::vector<proto::uinteger>>(std::move(data));
+    co_return true;
+}
+
 auto Server::on_semantic_token(proto::SemanticTokensParams params) -> Result {
     auto path = mapping.to_path(params.textDocument.uri);
     auto opening_file = opening_files.get_or_add(path);
-    auto version = opening_file->version;
 
-    auto guard = co_await opening_file->ast_built_lock.try_lock();
-    auto ast = opening_file->ast;
+    if(!co_await update_semantic_tokens(path, opening_file)) {
+        co_return json::Value(nullptr);
+    }
 
-    if(opening_file->version != version || !ast) {
+    auto& cache = opening_file->semantic_tokens;
+    cache.reported_id = cache.id;
+    cache.reported = cache.data;
+    co_return json::Object{
+        {"resultId", std::to_string(cache.id)},
+        {"data",     json::serialize(*cache.data)},
+    };
+}
+
+auto Server::on_semantic_token_delta(proto::SemanticTokensDeltaParams params) -> Result {
+    auto path = mapping.to_path(params.textDocument.uri);
+    auto opening_file = opening_files.get_or_add(path);
+
+    if(!co_await update_semantic_tokens(path, opening_file)) {
         co_return json::Value(nullptr);
     }
 
-    co_return co_await async::submit([kind = this->kind, &ast] {
-        auto tokens = feature::semantic_tokens(*ast);
-        return proto::to_json(kind, ast->interested_content(), tokens);
-    });
+    auto& cache = opening_file->semantic_tokens;
+    auto previous = std::exchange(cache.reported, cache.data);
+    auto previous_id = std::to_string(std::exchange(cache.reported_id, cache.id));
+
+    /// The client refers to an unknown result, fallback to full tokens.
+    if(!previous || params.previousResultId != previous_id) {
+        co_return json::Object{
+            {"resultId", std::to_string(cache.id)},
+            {"data",     json::serialize(*cache.data)},
+        };
+    }
+
+    proto::SemanticTokensDelta delta;
+    delta.resultId = std::to_string(cache.id);
+    if(previous != cache.data) {
+        delta.edits.emplace_back(proto::diff_semantic_tokens(*previous, *cache.data));
+    }
+    co_return json::serialize(delta);
+}
+
+auto Server::on_semantic_token_range(proto::SemanticTokensRangeParams params) -> Result {
+    auto path = mapping.to_path(params.textDocument.uri);
+    auto opening_file = opening_files.get_or_add(path);
+
+    /// Before the AST is built, the viewport is served from the stored index which the
+    /// cached features are loaded from, only the tokens in the range are read.
+    if(!opening_file->ast) {
+        auto features = co_await get_features(path, opening_file);
+        if(features && features->index) {
+            co_return co_await async::submit([&features, &params, kind = this->kind] {
+                PositionConverter converter(features->lines, kind);
+                LocalSourceRange range{
+                    converter.to_offset(params.range.start),
+                    converter.to_offset(params.range.end),
+                };
+                auto data = proto::to_semantic_tokens(converter, features->index->tokens(range));
+                return json::Value(json::Object{
+                    {"data", json::serialize(data)},
+                });
+            });
+        }
+    }
+
+    if(!co_await update_semantic_tokens(path, opening_file)) {
+        co_return json::Value(nullptr);
+    }
+
+    auto& cache = opening_file->semantic_tokens;
+    auto data = proto::slice_semantic_tokens(*cache.data,
+                                             params.range.start.line,
+                                             params.range.end.line);
+    co_return json::Object{
+        {"data", json::serialize(data)},
+    };
 }
 
 auto Server::on_inlay_hint(proto::InlayHintParams params) -> Result {
@@ -276,17 +907,15 @@ auto Server::on_inlay_hint(proto::InlayHintParams params) -> Result {
     }
 
     co_return co_await async::submit([kind = this->kind, &params, &ast] {
-        auto content = ast->interested_content();
+        PositionConverter converter(ast->interested_content(), kind);
 
         LocalSourceRange range{
-            to_offset(kind, content, params.range.start),
-            to_offset(kind, content, params.range.end),
+            converter.to_offset(params.range.start),
+            converter.to_offset(params.range.end),
         };
 
         auto hints = feature::inlay_hints(*ast, range, {});
 
-        PositionConverter converter(content, kind);
-
         std::vector<proto::InlayHint> result;
 
         for(auto& hint: hints) {
@@ -301,4 +930,443 @@ auto Server::on_inlay_hint(proto::InlayHintParams params) -> Result {
     });
 }
 
+auto Server::on_workspace_symbol(proto::WorkspaceSymbolParams params) -> Result {
+    /// Copy the results, the name index may be updated while converting them.
+    struct Found {
+        index::NameIndex::Symbol symbol;
+        std::string file;
+    };
+
+    std::vector<Found> founds;
+    for(auto& result: indexer.search_symbols(params.query, MaxWorkspaceSymbols)) {
+        founds.emplace_back(*result.symbol, result.file.str());
+    }
+
+    co_return co_await async::submit([&, kind = this->kind] {
+        /// The ranges are offsets in the indexed content, so convert them with the content
+        /// stored in the index rather than the current one on disk.
+        struct File {
+            std::string content;
+            std::optional<PositionConverter> converter;
+        };
+
+        llvm::StringMap<File> files;
+
+        std::vector<proto::SymbolInformation> result;
+        for(auto& [symbol, path]: founds) {
+            auto [it, success] = files.try_emplace(path);
+            auto& file = it->second;
+            if(success) {
+                if(auto index = indexer.load_symbols(path)) {
+                    file.content = index->content();
+                } else if(auto content = fs::read(path)) {
+                    file.content = std::move(*content);
+                }
+                file.converter.emplace(file.content, kind);
+            }
+
+            if(symbol.range.end > file.content.size()) {
+                continue;
+            }
+
+            auto& information = result.emplace_back();
+            information.name = symbol.name;
+            information.kind = proto::kind_map(symbol.kind);
+            information.location.uri = mapping.to_uri(path);
+            information.location.range = file.converter->lookup(symbol.range);
+            llvm::StringRef container = symbol.scope;
+            container.consume_back("::");
+            information.containerName = container.str();
+        }
+
+        return json::serialize(result);
+    });
+}
+
+async::Task<std::optional<index::SymbolIndex>> Server::get_symbols(std::string path) {
+    std::shared_ptr<OpenFile> file;
+    if(opening_files.contains(path)) {
+        file = opening_files.get_or_add(path);
+    }
+
+    auto stored = co_await async::submit([&] { return indexer.load_symbols(path); });
+    if(!file || file->version == 0) {
+        co_return stored;
+    }
+
+    /// The editing content may be different from the indexed one, then the offsets in the
+    /// stored index are meaningless for it.
+    auto version = file->version;
+    if(stored && stored->hash() == llvm::xxh3_64bits(file->content)) {
+        co_return stored;
+    }
+
+    /// Build the index from current AST instead and cache it until the content is changed.
+    /// Hold the lock like other requests using the AST.
+    auto guard = co_await file->ast_built_lock.try_lock();
+    auto ast = file->ast;
+
+    /// If building AST fails after the last change, the AST is still of the old content.
+    if(file->version != version || !ast || ast->interested_content() != file->content) {
+        co_return std::nullopt;
+    }
+
+    if(file->symbols) {
+        co_return file->symbols;
+    }
+
+    file->symbols = co_await async::submit([&ast] {
+        auto indices = index::memory::index(*ast);
+        return index::SymbolIndex::from(index::SymbolIndex::build(*indices.tu_index));
+    });
+    co_return file->symbols;
+}
+
+async::Task<std::vector<index::SymbolIndex>> Server::find_indices(
+    std::uint64_t hash,
+    const index::SymbolIndex* current) {
+    auto stored = co_await indexer.find_indices(hash);
+
+    std::vector<index::SymbolIndex> indices;
+    for(auto& file: stored) {
+        auto path = file.path();
+        if(current && path == current->path()) {
+            continue;
+        }
+
+        if(!opening_files.contains(path)) {
+            indices.emplace_back(std::move(file));
+            continue;
+        }
+
+        auto symbols = co_await get_symbols(path.str());
+        if(symbols && symbols->locateSymbol(hash)) {
+            indices.emplace_back(std::move(*symbols));
+        }
+    }
+
+    /// The symbol may only occur in the editing content, which is not indexed yet.
+    if(current && current->locateSymbol(hash)) {
+        auto it =
+            ranges::lower_bound(indices, current->path(), std::less{}, &index::SymbolIndex::path);
+        indices.insert(it, *current);
+    }
+
+    co_return indices;
+}
+
+async::Task<json::Value> Server::lookup(std::string path,
+                                        proto::Position position,
+                                        RelationKind kinds,
+                                        std::optional<json::Value> token,
+                                        bool implementation) {
+    auto index = co_await get_symbols(path);
+    if(!index) {
+        co_return json::Value(nullptr);
+    }
+
+    /// The offsets of the index are consistent with the current content of the file.
+    auto offset = PositionConverter(index->content(), kind).to_offset(position);
+
+    std::vector<std::uint64_t> symbols;
+    for(auto symbol: index->locateSymbol(offset)) {
+        symbols.emplace_back(symbol.hash());
+    }
+
+    if(implementation) {
+        /// The implementations are the overriding methods and derived classes, which are
+        /// recorded in the relations of the symbol.
+        llvm::DenseSet<std::uint64_t> targets;
+        for(auto hash: symbols) {
+            auto files = co_await find_indices(hash, &*index);
+            for(auto& file: files) {
+                auto symbol = file.locateSymbol(hash);
+                if(!symbol) {
+                    continue;
+                }
+
+                for(auto relation: symbol->relations()) {
+                    auto kind = relation.kind();
+                    if(kind.is_one_of(RelationKind::Implementation, RelationKind::Derived)) {
+                        targets.insert(relation.target_hash());
+                    }
+                }
+            }
+        }
+        symbols.assign(targets.begin(), targets.end());
+        ranges::sort(symbols);
+    }
+
+    json::Array result;
+    llvm::StringSet<> visited;
+
+    for(auto hash: symbols) {
+        /// Only the indices of files containing the symbol are loaded.
+        auto files = co_await find_indices(hash, &*index);
+        for(auto& file: files) {
+            auto symbol = file.locateSymbol(hash);
+            if(!symbol) {
+                continue;
+            }
+
+            std::vector<LocalSourceRange> found;
+            for(auto relation: symbol->relations()) {
+                auto range = relation.range();
+                if((relation.kind() & kinds) && range.valid() &&
+                   visited.insert(std::format("{}:{}:{}", file.path(), range.begin, range.end))
+                       .second) {
+                    found.emplace_back(range);
+                }
+            }
+
+            if(found.empty()) {
+                continue;
+            }
+
+            auto locations = co_await async::submit([&, kind = this->kind] {
+                PositionConverter converter(file.content(), kind);
+                auto uri = mapping.to_uri(file.path());
+
+                json::Array locations;
+                for(auto range: found) {
+                    locations.emplace_back(json::serialize(proto::Location{
+                        .uri = uri,
+                        .range = converter.lookup(range),
+                    }));
+                }
+                return locations;
+            });
+
+            /// Report the locations of each file as soon as they are found.
+            if(token) {
+                co_await notify("$/progress",
+                                json::Object{
+                                    {"token", *token             },
+                                    {"value", std::move(locations)},
+                });
+            } else {
+                for(auto& location: locations) {
+                    result.emplace_back(std::move(location));
+                }
+            }
+        }
+    }
+
+    co_return json::Value(std::move(result));
+}
+
+auto Server::on_definition(proto::DefinitionParams params) -> Result {
+    auto path = mapping.to_path(params.textDocument.uri);
+    co_return co_await lookup(path,
+                              params.position,
+                              RelationKind::Definition,
+                              std::move(params.partialResultToken));
+}
+
+auto Server::on_declaration(proto::DeclarationParams params) -> Result {
+    auto path = mapping.to_path(params.textDocument.uri);
+    co_return co_await lookup(path,
+                              params.position,
+                              RelationKind::Declaration,
+                              std::move(params.partialResultToken));
+}
+
+auto Server::on_implementation(proto::ImplementationParams params) -> Result {
+    auto path = mapping.to_path(params.textDocument.uri);
+    co_return co_await lookup(path,
+                              params.position,
+                              RelationKind::Definition,
+                              std::move(params.partialResultToken),
+                              /*implementation=*/true);
+}
+
+auto Server::on_references(proto::ReferenceParams params) -> Result {
+    auto path = mapping.to_path(params.textDocument.uri);
+
+    RelationKind kinds(RelationKind::Reference, RelationKind::WeakReference);
+    if(params.context.includeDeclaration) {
+        kinds |= RelationKind::Declaration;
+        kinds |= RelationKind::Definition;
+    }
+
+    co_return co_await lookup(path, params.position, kinds, std::move(params.partialResultToken));
+}
+
+async::Task<json::Value> Server::prepare_hierarchy(std::string path,
+                                                   proto::Position position,
+                                                   bool types) {
+    auto index = co_await get_symbols(path);
+    if(!index) {
+        co_return json::Value(nullptr);
+    }
+
+    /// Like `lookup`, the offsets of the index are consistent with the current content.
+    auto offset = PositionConverter(index->content(), kind).to_offset(position);
+
+    auto find = [&](std::uint64_t symbol) { return find_indices(symbol, &*index); };
+
+    std::vector<HierarchyEntry> entries;
+    for(auto symbol: index->locateSymbol(offset)) {
+        auto symbol_kind = symbol.kind();
+        if(types ? !symbol_kind.is_one_of(SymbolKind::Class, SymbolKind::Struct, SymbolKind::Union)
+                 : !symbol_kind.is_one_of(SymbolKind::Function, SymbolKind::Method)) {
+            continue;
+        }
+
+        if(auto entry = co_await locate_entry(find, symbol.hash(), &*index)) {
+            entries.emplace_back(std::move(*entry));
+        }
+    }
+
+    co_return co_await async::submit([&, kind = this->kind] {
+        HierarchyConverter converter(mapping, kind);
+
+        std::vector<proto::CallHierarchyItem> items;
+        for(auto& entry: entries) {
+            items.emplace_back(converter.item(entry));
+        }
+        return json::serialize(items);
+    });
+}
+
+async::Task<json::Value> Server::hierarchy_calls(std::string data, bool incoming) {
+    auto hash = item_hash(data);
+    if(!hash) {
+        co_return json::Value(nullptr);
+    }
+
+    /// Both directions of a call are recorded when the index is written, the callee has
+    /// a `Caller` relation and the caller has a `Callee` relation. So expanding a node only
+    /// reads the symbol in the files containing it, rather than scanning all symbols.
+    ///
+    /// It is still not proportional to the count of calls. All files containing the symbol
+    /// are loaded, including the ones which only reference it, and then the files of each
+    /// caller (or callee) are loaded again to locate its definition.
+    RelationKind kinds = incoming ? RelationKind::Caller : RelationKind::Callee;
+
+    std::vector<HierarchyEntry> entries;
+    llvm::StringSet<> visited;
+    auto find = [&](std::uint64_t symbol) { return find_indices(symbol); };
+    auto files = co_await find(*hash);
+    for(auto& file: files) {
+        auto symbol = file.locateSymbol(*hash);
+        if(!symbol) {
+            continue;
+        }
+
+        /// Group the calls by the symbol on the other side.
+        llvm::MapVector<std::uint64_t, std::vector<LocalSourceRange>> calls;
+        for(auto relation: symbol->relations()) {
+            auto range = relation.range();
+            auto target = relation.target_hash();
+            if((relation.kind() & kinds) &&
+               visited
+                   .insert(std::format("{}:{}:{}:{}", file.path(), range.begin, range.end, target))
+                   .second) {
+                calls[target].emplace_back(range);
+            }
+        }
+
+        for(auto& [target, found]: calls) {
+            auto entry = co_await locate_entry(find, target, &file);
+            if(!entry) {
+                continue;
+            }
+
+            entry->calls_index = file;
+            entry->calls = std::move(found);
+            entries.emplace_back(std::move(*entry));
+        }
+    }
+
+    co_return co_await async::submit([&, kind = this->kind] {
+        HierarchyConverter converter(mapping, kind);
+
+        json::Array result;
+        for(auto& entry: entries) {
+            auto& positions = converter.positions(*entry.calls_index);
+
+            std::vector<proto::Range> ranges;
+            for(auto range: entry.calls) {
+                ranges.emplace_back(positions.lookup(range));
+            }
+
+            result.emplace_back(json::Object{
+                {incoming ? "from" : "to", json::serialize(converter.item(entry))},
+                {"fromRanges",             json::serialize(ranges)              },
+            });
+        }
+        return json::Value(std::move(result));
+    });
+}
+
+async::Task<json::Value> Server::hierarchy_types(std::string data, bool supertypes) {
+    auto hash = item_hash(data);
+    if(!hash) {
+        co_return json::Value(nullptr);
+    }
+
+    /// Like calls, the derived class has a `Base` relation and the base class has a
+    /// `Derived` relation, both recorded in the file of the base specifier.
+    RelationKind kinds = supertypes ? RelationKind::Base : RelationKind::Derived;
+
+    std::vector<HierarchyEntry> entries;
+    llvm::DenseSet<std::uint64_t> visited;
+    auto find = [&](std::uint64_t symbol) { return find_indices(symbol); };
+    auto files = co_await find(*hash);
+    for(auto& file: files) {
+        auto symbol = file.locateSymbol(*hash);
+        if(!symbol) {
+            continue;
+        }
+
+        for(auto relation: symbol->relations()) {
+            auto target = relation.target_hash();
+            if(!(relation.kind() & kinds) || !visited.insert(target).second) {
+                continue;
+            }
+
+            if(auto entry = co_await locate_entry(find, target, &file)) {
+                entries.emplace_back(std::move(*entry));
+            }
+        }
+    }
+
+    co_return co_await async::submit([&, kind = this->kind] {
+        HierarchyConverter converter(mapping, kind);
+
+        std::vector<proto::TypeHierarchyItem> items;
+        for(auto& entry: entries) {
+            items.emplace_back(converter.item(entry));
+        }
+        return json::serialize(items);
+    });
+}
+
+auto Server::on_prepare_call_hierarchy(proto::CallHierarchyPrepareParams params) -> Result {
+    auto path = mapping.to_path(params.textDocument.uri);
+    co_return co_await prepare_hierarchy(path, params.position, /*types=*/false);
+}
+
+auto Server::on_incoming_calls(proto::CallHierarchyIncomingCallsParams params) -> Result {
+    co_return co_await hierarchy_calls(std::move(params.item.data), /*incoming=*/true);
+}
+
+auto Server::on_outgoing_calls(proto::CallHierarchyOutgoingCallsParams params) -> Result {
+    co_return co_await hierarchy_calls(std::move(params.item.data), /*incoming=*/false);
+}
+
+auto Server::on_prepare_type_hierarchy(proto::TypeHierarchyPrepareParams params) -> Result {
+    auto path = mapping.to_path(params.textDocument.uri);
+    co_return co_await prepare_hierarchy(path, params.position, /*types=*/true);
+}
+
+auto Server::on_supertypes(proto::TypeHierarchySupertypesParams params) -> Result {
+    co_return co_await hierarchy_types(std::move(params.item.data), /*supertypes=*/true);
+}
+
+auto Server::on_subtypes(proto::TypeHierarchySubtypesParams params) -> Result {
+    co_return co_await hierarchy_types(std::move(params.item.data), /*supertypes=*/false);
+}
+
 }  // namespace clice
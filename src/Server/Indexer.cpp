@@ -3,12 +3,461 @@
 #include "Index/Index.h"
 #include "Server/Indexer.h"
 #include "Support/Logging.h"
+#include "Support/Ranges.h"
+#include "Support/FileSystem.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/xxhash.h"
 
 namespace clice {
 
+namespace {
+
+/// Whether the symbol could be searched by name.
+bool is_named_kind(SymbolKind kind) {
+    switch(kind.kind()) {
+        case SymbolKind::Macro:
+        case SymbolKind::Namespace:
+        case SymbolKind::Class:
+        case SymbolKind::Struct:
+        case SymbolKind::Union:
+        case SymbolKind::Enum:
+        case SymbolKind::Type:
+        case SymbolKind::EnumMember:
+        case SymbolKind::Function:
+        case SymbolKind::Variable:
+        case SymbolKind::Concept: return true;
+        default: return false;
+    }
+}
+
+/// Collect the symbols declared in the index, which could be referenced by other files.
+/// If `tu_local` is true, the symbols only visible in the translation unit are included.
+std::vector<index::NameIndex::Symbol> global_symbols(const index::memory::RawIndex& index,
+                                                     bool tu_local = false) {
+    std::vector<index::NameIndex::Symbol> symbols;
+    for(auto& [_, symbol]: index.symbols) {
+        if(symbol.name.empty() || (symbol.is_tu_local && !tu_local) ||
+           symbol.is_function_local || !is_named_kind(symbol.kind)) {
+            continue;
+        }
+
+        /// Prefer the definition to declarations.
+        std::optional<LocalSourceRange> range;
+        for(auto relation: symbol.relations) {
+            if(relation.kind & RelationKind::Definition) {
+                range = relation.range;
+                break;
+            } else if(relation.kind.isDeclOrDef() && !range) {
+                range = relation.range;
+            }
+        }
+
+        if(range) {
+            symbols.emplace_back(symbol.name, symbol.scope, symbol.kind, *range);
+        }
+    }
+    return symbols;
+}
+
+/// Same as above, but collect from the stored symbol index.
+std::vector<index::NameIndex::Symbol> global_symbols(const index::SymbolIndex& index,
+                                                     bool tu_local = false) {
+    std::vector<index::NameIndex::Symbol> symbols;
+    for(auto symbol: index.symbols()) {
+        if(symbol.name().empty() || (symbol.is_tu_local() && !tu_local) ||
+           symbol.is_function_local() || !is_named_kind(symbol.kind())) {
+            continue;
+        }
+
+        std::optional<LocalSourceRange> range;
+        for(auto relation: symbol.relations()) {
+            auto kind = relation.kind();
+            if(kind & RelationKind::Definition) {
+                range = relation.range();
+                break;
+            } else if(kind.isDeclOrDef() && !range) {
+                range = relation.range();
+            }
+        }
+
+        if(range) {
+            symbols.emplace_back(symbol.name().str(), symbol.scope().str(), symbol.kind(), *range);
+        }
+    }
+    return symbols;
+}
+
+/// Create the directory if it doesn't exist, return false on failure.
+bool ensure_directory(llvm::StringRef dir) {
+    if(fs::exists(dir)) {
+        return true;
+    }
+
+    if(auto error = fs::create_directories(dir)) {
+        logging::warn("Fail to create index directory: {}, because: {}", dir, error.message());
+        return false;
+    }
+    return true;
+}
+
+/// Write to a temporary file first and then rename it, so that a broken file will never
+/// be loaded.
+void write_index(llvm::StringRef file, llvm::StringRef path, llvm::ArrayRef<char> buffer) {
+    auto temp_path = path.str() + ".tmp";
+    if(auto result = fs::write(temp_path, llvm::StringRef(buffer.data(), buffer.size()));
+       !result) {
+        logging::warn("Fail to write index of {}, because: {}", file, result.error());
+        return;
+    }
+
+    if(auto error = fs::rename(temp_path, path)) {
+        logging::warn("Fail to rename index of {}: {}", file, error.message());
+    }
+}
+
+/// Whether the stored shard of translation unit is built from the same content, arguments
+/// and included files.
+bool is_up_to_date(const index::SymbolIndex& index,
+                   std::uint64_t content_hash,
+                   const index::SymbolIndex::Dependencies& dependencies) {
+    if(index.hash() != content_hash || index.arguments_hash() != dependencies.arguments) {
+        return false;
+    }
+
+    /// The stored includes are sorted by path.
+    auto includes = dependencies.includes;
+    ranges::sort(includes);
+
+    auto stored = index.includes();
+    if(stored.length() != includes.size()) {
+        return false;
+    }
+
+    for(std::size_t i = 0; i < includes.size(); ++i) {
+        auto include = stored[i];
+        if(include.path() != includes[i].first || include.hash() != includes[i].second) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+void Indexer::update_names(const index::memory::Indices& indices) {
+    for(auto& [fid, index]: indices.header_indices) {
+        if(fid < clang::FileID::getSentinel()) {
+            continue;
+        }
+
+        names.update(index->path, llvm::xxh3_64bits(index->content), global_symbols(*index));
+    }
+}
+
+std::vector<index::NameIndex::Result> Indexer::search_symbols(llvm::StringRef query,
+                                                              std::size_t limit) {
+    auto results = names.query(query, limit);
+    auto source_results = sources.query(query, limit);
+    results.insert(results.end(), source_results.begin(), source_results.end());
+
+    ranges::stable_sort(results, std::greater{}, &index::NameIndex::Result::score);
+    if(limit != 0 && results.size() > limit) {
+        results.resize(limit);
+    }
+    return results;
+}
+
+void Indexer::add_symbols(PathID file, const index::memory::RawIndex& index) {
+    /// The file may be indexed with different contents, the symbols are only added and
+    /// never removed. The outdated entries are filtered out when querying.
+    symbol_hashes[file] = llvm::xxh3_64bits(index.content);
+    for(auto& [id, _]: index.symbols) {
+        symbol_indices[id].insert(file);
+    }
+}
+
+void Indexer::add_symbols(PathID file, const index::SymbolIndex& index) {
+    symbol_hashes[file] = index.hash();
+    for(auto symbol: index.symbols()) {
+        symbol_indices[symbol.hash()].insert(file);
+    }
+}
+
+async::Task<std::vector<index::SymbolIndex>> Indexer::find_indices(std::uint64_t symbol) {
+    std::vector<index::SymbolIndex> indices;
+    auto it = symbol_indices.find(symbol);
+    if(it == symbol_indices.end()) {
+        co_return indices;
+    }
+
+    /// Sort the files, so that the results are stable. The paths are copied, the storage
+    /// may grow while loading.
+    std::vector<std::string> files;
+    for(auto id: it->second) {
+        files.emplace_back(path_storage[id]);
+    }
+    ranges::sort(files);
+
+    co_await async::submit([&] {
+        for(auto& file: files) {
+            if(auto index = load_symbols(file)) {
+                indices.emplace_back(std::move(*index));
+            }
+        }
+    });
+    co_return indices;
+}
+
+std::string Indexer::feature_index_path(llvm::StringRef path) {
+    auto name = llvm::utohexstr(llvm::xxh3_64bits(path), /*LowerCase=*/true) + ".fidx";
+    return path::join(config.project.index_dir, "features", name);
+}
+
+std::optional<index::FeatureIndex> Indexer::load_features(llvm::StringRef path,
+                                                          llvm::StringRef content) {
+    auto index = index::FeatureIndex::load(feature_index_path(path));
+    if(!index || index->hash() != llvm::xxh3_64bits(content) || index->path() != path) {
+        return std::nullopt;
+    }
+    return index;
+}
+
+void Indexer::save_features(CompilationUnit& unit) {
+    if(!ensure_directory(path::join(config.project.index_dir, "features"))) {
+        return;
+    }
+
+    for(auto&& [fid, buffer]: index::FeatureIndex::build(unit)) {
+        /// FIXME: The files from PCH or module are skipped, like symbol indices.
+        if(fid < clang::FileID::getSentinel()) {
+            continue;
+        }
+
+        auto file = unit.file_path(fid);
+        if(load_features(file, unit.file_content(fid))) {
+            continue;
+        }
+
+        write_index(file, feature_index_path(file), buffer);
+    }
+}
+
+std::string Indexer::symbol_index_path(llvm::StringRef path) {
+    auto name = llvm::utohexstr(llvm::xxh3_64bits(path), /*LowerCase=*/true) + ".sidx";
+    return path::join(config.project.index_dir, "symbols", name);
+}
+
+std::optional<index::SymbolIndex> Indexer::load_symbols(llvm::StringRef path) {
+    auto index = index::SymbolIndex::load(symbol_index_path(path));
+    if(!index || index->path() != path) {
+        return std::nullopt;
+    }
+    return index;
+}
+
+void Indexer::save_symbols(const index::memory::Indices& indices,
+                           const index::SymbolIndex::Dependencies& dependencies) {
+    if(!ensure_directory(path::join(config.project.index_dir, "symbols"))) {
+        return;
+    }
+
+    /// The translation unit is always written, its arguments or includes may be changed
+    /// even if its content is not.
+    auto& tu_index = *indices.tu_index;
+    write_index(tu_index.path,
+                symbol_index_path(tu_index.path),
+                index::SymbolIndex::build(tu_index, dependencies));
+
+    for(auto& [fid, index]: indices.header_indices) {
+        /// FIXME: The files from PCH or module are skipped, like in-memory indices.
+        if(fid < clang::FileID::getSentinel()) {
+            continue;
+        }
+
+        /// The header shard is up to date if the content is not changed. It keeps the
+        /// context of the unit writing it, see `find_indices`.
+        auto stored = load_symbols(index->path);
+        if(stored && stored->hash() == llvm::xxh3_64bits(index->content)) {
+            continue;
+        }
+
+        write_index(index->path, symbol_index_path(index->path), index::SymbolIndex::build(*index));
+    }
+}
+
+std::uint64_t Indexer::arguments_hash(llvm::StringRef file) {
+    std::string arguments;
+    for(auto argument: database.get_command(file).arguments) {
+        arguments += argument;
+        arguments += '\0';
+    }
+    return llvm::xxh3_64bits(arguments);
+}
+
+async::Task<bool> Indexer::need_index(llvm::StringRef file) {
+    auto arguments = arguments_hash(file);
+
+    /// The stored shard of the file and the modification time of the file and its includes.
+    using File = std::tuple<llvm::StringRef, std::uint64_t, std::optional<llvm::sys::TimePoint<>>>;
+    std::optional<index::SymbolIndex> index;
+    std::vector<File> files;
+
+    co_await async::submit([&] {
+        index = load_symbols(file);
+        if(!index || index->arguments_hash() != arguments) {
+            return;
+        }
+
+        auto add_file = [&](llvm::StringRef path, std::uint64_t hash) {
+            fs::file_status status;
+            if(auto error = fs::status(path, status)) {
+                files.emplace_back(path, hash, std::nullopt);
+            } else {
+                files.emplace_back(path, hash, status.getLastModificationTime());
+            }
+        };
+
+        add_file(file, index->hash());
+        for(auto include: index->includes()) {
+            add_file(include.path(), include.hash());
+        }
+    });
+
+    if(files.empty()) {
+        co_return true;
+    }
+
+    /// Headers are shared by many translation units, their hashes are cached with the
+    /// modification time. Only the files modified since last check are hashed again.
+    std::vector<std::size_t> modified;
+    for(std::size_t i = 0; i < files.size(); ++i) {
+        auto& [path, hash, time] = files[i];
+        if(!time) {
+            co_return true;
+        }
+
+        auto it = content_hashes.find(path);
+        if(it == content_hashes.end() || it->second.first != *time) {
+            modified.emplace_back(i);
+        } else if(it->second.second != hash) {
+            co_return true;
+        }
+    }
+
+    std::vector<std::optional<std::uint64_t>> hashes(modified.size());
+    if(!modified.empty()) {
+        co_await async::submit([&] {
+            for(std::size_t i = 0; i < modified.size(); ++i) {
+                if(auto content = fs::read(std::get<0>(files[modified[i]]))) {
+                    hashes[i] = llvm::xxh3_64bits(*content);
+                }
+            }
+        });
+    }
+
+    bool changed = false;
+    for(std::size_t i = 0; i < modified.size(); ++i) {
+        auto& [path, hash, time] = files[modified[i]];
+        if(!hashes[i]) {
+            changed = true;
+            continue;
+        }
+
+        content_hashes[path] = {*time, *hashes[i]};
+        changed |= *hashes[i] != hash;
+    }
+
+    if(changed) {
+        co_return true;
+    }
+
+    /// Nothing is changed, reuse the stored shards of the unit and its headers.
+    co_await reuse_shards(file, *index);
+    co_return false;
+}
+
+async::Task<> Indexer::reuse_shards(llvm::StringRef file, const index::SymbolIndex& index) {
+    static_indices[getPath(file)] = symbol_index_path(file);
+    sources.update(file, index.hash(), global_symbols(index, true));
+    add_symbols(getPath(file), index);
+
+    /// Headers are shared by many units, only load them if they are not added yet.
+    std::vector<llvm::StringRef> headers;
+    for(auto include: index.includes()) {
+        auto id = getPath(include.path());
+        auto it = symbol_hashes.find(id);
+        if(it != symbol_hashes.end() && it->second == include.hash() &&
+           names.contains(include.path(), include.hash())) {
+            static_indices[id] = symbol_index_path(include.path());
+            continue;
+        }
+
+        headers.emplace_back(include.path());
+    }
+
+    if(headers.empty()) {
+        co_return;
+    }
+
+    std::vector<std::optional<index::SymbolIndex>> loaded(headers.size());
+    co_await async::submit([&] {
+        for(std::size_t i = 0; i < headers.size(); ++i) {
+            loaded[i] = load_symbols(headers[i]);
+        }
+    });
+
+    for(std::size_t i = 0; i < headers.size(); ++i) {
+        auto& header = loaded[i];
+        if(!header) {
+            continue;
+        }
+
+        auto id = getPath(headers[i]);
+        static_indices[id] = symbol_index_path(headers[i]);
+        names.update(header->path(), header->hash(), global_symbols(*header));
+        add_symbols(id, *header);
+    }
+}
+
 async::Task<> Indexer::index(CompilationUnit& unit) {
-    auto [tu_index, header_indices] =
-        co_await async::submit([&] { return index::memory::index(unit); });
+    auto path = unit.file_path(unit.interested_file()).str();
+    auto arguments = arguments_hash(path);
+    auto [hash, dependencies, stored] = co_await async::submit([&] {
+        return std::tuple(llvm::xxh3_64bits(unit.interested_content()),
+                          index::SymbolIndex::dependencies(unit, arguments),
+                          load_symbols(path));
+    });
+
+    /// Rebuilding the AST doesn't always change anything, e.g. saving the file without
+    /// modification, reuse the stored shards if neither the content nor dependencies change.
+    if(stored && is_up_to_date(*stored, hash, dependencies)) {
+        co_await reuse_shards(path, *stored);
+        co_return;
+    }
+
+    auto indices = co_await async::submit([&] { return index::memory::index(unit); });
+    update_names(indices);
+
+    auto& tu = *indices.tu_index;
+    sources.update(tu.path, llvm::xxh3_64bits(tu.content), global_symbols(tu, true));
+
+    /// Store the features, so that they are available before the AST is built next time.
+    /// The symbol shards are stored likewise, so that a restart needn't index again.
+    co_await async::submit([&] {
+        save_features(unit);
+        save_symbols(indices, dependencies);
+    });
+
+    auto& [tu_index, header_indices] = indices;
+
+    static_indices[getPath(tu_index->path)] = symbol_index_path(tu_index->path);
+    add_symbols(getPath(tu_index->path), *tu_index);
+    for(auto& [fid, index]: header_indices) {
+        if(fid >= clang::FileID::getSentinel()) {
+            static_indices[getPath(index->path)] = symbol_index_path(index->path);
+            add_symbols(getPath(index->path), *index);
+        }
+    }
 
     auto tu_id = getPath(tu_index->path);
 
@@ -30,7 +479,10 @@ async::Task<> Indexer::index(CompilationUnit& unit) {
             auto& indices = it->second;
 
             if(!visited_headers.contains(id)) {
-                indices->unmergeds[tu_id].clear();
+                /// The unmerged indices from the last indexing of the unit are outdated.
+                auto& unmergeds = indices->unmergeds[tu_id];
+                unmerged_count -= unmergeds.size();
+                unmergeds.clear();
                 visited_headers.insert(id);
             }
 
@@ -40,15 +492,150 @@ async::Task<> Indexer::index(CompilationUnit& unit) {
             it->second->unmergeds[tu_id].emplace_back(include, std::move(index));
             visited_headers.insert(id);
         }
+
+        unmerged_count += 1;
     }
 
     dynamic_tu_indices[tu_id] = std::move(tu_index);
+
+    schedule_merge();
+}
+
+std::uint32_t Indexer::unmerged_indices(llvm::StringRef header) {
+    auto it = dynamic_header_indices.find(getPath(header));
+    if(it == dynamic_header_indices.end()) {
+        return 0;
+    }
+
+    std::uint32_t count = 0;
+    for(auto& [_, unmergeds]: it->second->unmergeds) {
+        count += unmergeds.size();
+    }
+    return count;
+}
+
+const index::memory::HeaderIndex* Indexer::merged_index(llvm::StringRef header) {
+    auto it = dynamic_header_indices.find(getPath(header));
+    if(it == dynamic_header_indices.end()) {
+        return nullptr;
+    }
+    return it->second->merged.get();
+}
+
+void Indexer::schedule_merge() {
+    if(unmerged_count < config.index.merge_threshold) {
+        return;
+    }
+
+    /// If a merge is running, the new indices will be merged by it.
+    if(!merge_task.empty()) {
+        if(!merge_task.finished()) {
+            return;
+        }
+        merge_task.release().destroy();
+    }
+
+    merge_task = merge();
+    merge_task.schedule();
+}
+
+async::Task<> Indexer::merge() {
+    /// The pending indices of a single header, headers are independent of each other
+    /// so that they are merged in parallel.
+    struct Shard {
+        HeaderIndices* indices;
+
+        /// The merged index of the header, taken out during merging.
+        std::unique_ptr<index::memory::HeaderIndex> merged;
+
+        /// The translation units that include the header and their raw indices of it.
+        std::vector<std::pair<std::string, std::vector<HeaderIndices::RawIndex>>> units;
+
+        std::size_t count = 0;
+    };
+
+    while(unmerged_count >= config.index.merge_threshold) {
+        /// Take all unmerged indices, so that indexing could continue in the meantime.
+        std::vector<Shard> shards;
+        for(auto& [id, indices]: dynamic_header_indices) {
+            if(indices->unmergeds.empty()) {
+                continue;
+            }
+
+            auto& shard = shards.emplace_back(indices.get(), std::move(indices->merged));
+            if(!shard.merged) {
+                shard.merged = std::make_unique<index::memory::HeaderIndex>();
+            }
+
+            for(auto& [tu_id, unmergeds]: indices->unmergeds) {
+                shard.count += unmergeds.size();
+                shard.units.emplace_back(path_storage[tu_id], std::move(unmergeds));
+            }
+            indices->unmergeds.clear();
+        }
+
+        if(shards.empty()) {
+            break;
+        }
+
+        logging::info("Merge {} header indices of {} headers", unmerged_count, shards.size());
+        unmerged_count = 0;
+
+        /// Start with the largest shards, so that a few huge headers don't leave the other
+        /// workers idle at the end.
+        ranges::sort(shards, std::greater{}, &Shard::count);
+
+        /// The same header contents are deduplicated by canonical context, and the raw
+        /// indices are freed after merging.
+        auto merge_shard = [](Shard& shard) -> async::Task<bool> {
+            co_await async::submit([&] {
+                for(auto& [tu, unmergeds]: shard.units) {
+                    /// The contexts from the last indexing of the unit are outdated.
+                    shard.merged->remove(tu);
+                    for(auto& [include, raw]: unmergeds) {
+                        shard.merged->merge(tu, include, *raw);
+                    }
+                    unmergeds.clear();
+                }
+            });
+            co_return true;
+        };
+
+        /// Merging runs in background like indexing, so it shares the same bound of threads.
+        co_await async::gather(shards, merge_shard, background_concurrency());
+
+        /// Publish all merged indices together after every shard is done.
+        for(auto& shard: shards) {
+            shard.indices->merged = std::move(shard.merged);
+        }
+    }
+}
+
+async::Task<> Indexer::wait_for_idle() {
+    std::chrono::milliseconds delay(config.index.idle_delay);
+    while(true) {
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - last_active);
+        if(elapsed >= delay) {
+            co_return;
+        }
+
+        co_await async::sleep(delay - elapsed);
+    }
+}
+
+std::size_t Indexer::background_concurrency() {
+    if(config.index.concurrency != 0) {
+        return config.index.concurrency;
+    }
+    return std::max(1u, std::thread::hardware_concurrency() / 2);
 }
 
-async::Task<> Indexer::index(llvm::StringRef file) {
+async::Task<> Indexer::index(llvm::StringRef file, llvm::StringMap<std::string> pcms) {
     CompilationParams params;
     params.kind = CompilationUnit::Indexing;
     params.arguments = database.get_command(file).arguments;
+    params.pcms = std::move(pcms);
 
     auto AST = co_await async::submit([&] { return compile(params); });
 
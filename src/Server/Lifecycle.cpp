@@ -1,4 +1,5 @@
 #include "Server/Server.h"
+#include "Support/Format.h"
 
 namespace clice {
 
@@ -9,6 +10,8 @@ async::Task<json::Value> Server::on_initialize(proto::InitializeParams params) {
 
     /// FIXME: adjust position encoding.
     kind = PositionEncodingKind::UTF16;
+    semantic_tokens_refresh = params.capabilities.workspace.semanticTokens.refreshSupport;
+    work_done_progress = params.capabilities.window.workDoneProgress;
     workspace = mapping.to_path(([&] -> std::string {
         if(params.workspaceFolders && !params.workspaceFolders->empty()) {
             return params.workspaceFolders->front().uri;
@@ -61,6 +64,12 @@ async::Task<json::Value> Server::on_initialize(proto::InitializeParams params) {
     /// SignatureHelp
     capabilities.signatureHelpProvider.triggerCharacters = {"(", ")", "{", "}", "<", ">", ","};
 
+    /// Declaration, definition, implementation and references
+    capabilities.declarationProvider.workDoneProgress = false;
+    capabilities.definitionProvider.workDoneProgress = false;
+    capabilities.implementationProvider.workDoneProgress = false;
+    capabilities.referencesProvider.workDoneProgress = false;
+
     /// DocumentSymbol
     capabilities.documentSymbolProvider = {};
 
@@ -75,23 +84,113 @@ async::Task<json::Value> Server::on_initialize(proto::InitializeParams params) {
     capabilities.foldingRangeProvider = true;
 
     /// Semantic tokens
-    capabilities.semanticTokensProvider.range = false;
-    capabilities.semanticTokensProvider.full = true;
+    capabilities.semanticTokensProvider.range = true;
+    capabilities.semanticTokensProvider.full.delta = true;
     for(auto name: SymbolKind::all()) {
         std::string type{name};
         type[0] = std::tolower(type[0]);
         capabilities.semanticTokensProvider.legend.tokenTypes.emplace_back(std::move(type));
     }
 
+    /// Call and type hierarchy
+    capabilities.callHierarchyProvider.workDoneProgress = false;
+    capabilities.typeHierarchyProvider.workDoneProgress = false;
+
     /// Inlay hint
     /// FIXME: Resolve to make hint clickable.
     capabilities.inlayHintProvider.resolveProvider = false;
 
+    /// WorkspaceSymbol
+    capabilities.workspaceSymbolProvider = {};
+
     co_return json::serialize(result);
 }
 
 async::Task<> Server::on_initialized(proto::InitializedParams) {
-    co_return;
+    /// Scan all modules in the project, so that files importing
+    /// modules could be compiled with the PCMs. Only files modified
+    /// since last scanning are scanned again.
+    module_graph.load();
+    co_await module_graph.scan();
+    module_graph.save();
+
+    /// Index after scanning modules, so that the PCMs could be found.
+    if(config.index.background) {
+        indexing_task = index_workspace();
+        indexing_task.schedule();
+    }
+}
+
+async::Task<> Server::index_workspace() {
+    auto files = database.files();
+    if(files.empty()) {
+        co_return;
+    }
+
+    logging::info("Start background indexing for {} files", files.size());
+
+    json::Value token = "clice/background-index";
+    auto report = [&](json::Object value) -> async::Task<> {
+        if(work_done_progress) {
+            co_await notify("$/progress",
+                            json::Object{
+                                {"token", token           },
+                                {"value", std::move(value)},
+            });
+        }
+    };
+
+    if(work_done_progress) {
+        co_await request("window/workDoneProgress/create", json::Object{{"token", token}});
+    }
+
+    co_await report(json::Object{
+        {"kind",       "begin"   },
+        {"title",      "Indexing"},
+        {"percentage", 0         },
+    });
+
+    std::size_t indexed = 0;
+    std::size_t last_percentage = 0;
+    auto index_one = [&](llvm::StringRef file) -> async::Task<bool> {
+        co_await indexer.wait_for_idle();
+
+        /// Opened files are indexed with their AST after building, indexing the file on disk
+        /// would replace the index of the editing content.
+        if(opening_files.contains(file)) {
+            logging::info("Skip indexing {}, it is opened", file);
+        } else if(!co_await indexer.need_index(file)) {
+            logging::info("Skip indexing {}, it is up to date", file);
+        } else {
+            llvm::StringMap<std::string> pcms;
+            if(!co_await module_graph.resolve(file.str(), pcms)) {
+                logging::warn("Fail to build imported modules for {}", file);
+            }
+            co_await indexer.index(file, std::move(pcms));
+        }
+
+        /// Only report when the percentage changes, to avoid flooding the client.
+        indexed += 1;
+        auto percentage = indexed * 100 / files.size();
+        if(percentage != last_percentage) {
+            last_percentage = percentage;
+            co_await report(json::Object{
+                {"kind",       "report"                                   },
+                {"message",    std::format("{}/{}", indexed, files.size())},
+                {"percentage", percentage                                 },
+            });
+        }
+
+        co_return true;
+    };
+
+    co_await async::gather(files, index_one, indexer.background_concurrency());
+
+    co_await report(json::Object{
+        {"kind", "end"},
+    });
+
+    logging::info("Background indexing finished, {} files are indexed", indexed);
 }
 
 async::Task<json::Value> Server::on_shutdown(proto::ShutdownParams params) {
@@ -99,7 +198,17 @@ async::Task<json::Value> Server::on_shutdown(proto::ShutdownParams params) {
 }
 
 async::Task<> Server::on_exit(proto::ExitParams params) {
+    if(!indexing_task.empty()) {
+        if(indexing_task.finished()) {
+            indexing_task.release().destroy();
+        } else {
+            indexing_task.cancel();
+            indexing_task.dispose();
+        }
+    }
+
     save_cache_info();
+    module_graph.save();
     async::stop();
     co_return;
 }
@@ -0,0 +1,632 @@
+#include "Server/ModuleGraph.h"
+#include "Compiler/Compilation.h"
+#include "Support/Binary.h"
+#include "Support/Logging.h"
+#include "Support/FileSystem.h"
+#include "llvm/ADT/ScopeExit.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/Support/xxhash.h"
+
+namespace clice {
+
+namespace {
+
+/// All modules imported by the unit, an implementation unit implicitly
+/// imports its primary module interface.
+std::vector<std::string> imported_modules(ModuleInfo& info) {
+    auto mods = std::move(info.mods);
+    if(!info.isInterfaceUnit && !info.name.empty() && !llvm::StringRef(info.name).contains(':')) {
+        mods.emplace_back(info.name);
+    }
+    return mods;
+}
+
+CommandOptions command_options() {
+    CommandOptions options;
+    options.resource_dir = true;
+    options.query_driver = true;
+    return options;
+}
+
+/// The on-disk layout of the module map cache.
+struct ModuleMapEntry {
+    std::string path;
+
+    ModuleInfo info;
+
+    std::uint64_t hash;
+
+    std::int64_t mtime;
+
+    std::uint64_t arguments;
+};
+
+struct ModuleMap {
+    /// The version of the layout, bump it when the layout is changed.
+    std::uint32_t version;
+
+    std::vector<ModuleMapEntry> entries;
+};
+
+constexpr std::uint32_t ModuleMapVersion = 2;
+
+/// The hash of compile arguments, the result of preprocessing depends on them.
+std::uint64_t arguments_hash(llvm::ArrayRef<const char*> arguments) {
+    std::string joined;
+    for(auto argument: arguments) {
+        joined += argument;
+        joined += '\0';
+    }
+    return llvm::xxh3_64bits(joined);
+}
+
+std::int64_t modification_time(llvm::StringRef file) {
+    fs::file_status status;
+    if(auto error = fs::status(file, status, true)) {
+        return 0;
+    }
+
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               status.getLastModificationTime().time_since_epoch())
+        .count();
+}
+
+}  // namespace
+
+void ModuleGraph::load() {
+    auto path = path::join(config.project.cache_dir, "modules.bin");
+    auto file = llvm::MemoryBuffer::getFile(path);
+    if(!file) {
+        logging::info("Fail to load module map, because: {}", file.getError());
+        return;
+    }
+
+    llvm::StringRef buffer = file.get()->getBuffer();
+    if(buffer.size() < sizeof(binary::binarify_t<ModuleMap>)) {
+        logging::warn("Fail to load module map, the file is broken");
+        return;
+    }
+
+    binary::Proxy<ModuleMap> map{buffer.data(), buffer.data()};
+    if(map.get<"version">().value() != ModuleMapVersion) {
+        logging::info("Fail to load module map, the module map is outdated");
+        return;
+    }
+
+    if(!binary::validate(map, buffer.size())) {
+        logging::warn("Fail to load module map, the file is broken");
+        return;
+    }
+
+    auto entries = map.get<"entries">();
+    for(std::size_t i = 0; i < entries.size(); ++i) {
+        auto entry = entries[i];
+        scan_results.try_emplace(entry.get<"path">().as_string(),
+                                 ScanResult{
+                                     binary::deserialize(entry.get<"info">()),
+                                     entry.get<"hash">().value(),
+                                     entry.get<"mtime">().value(),
+                                     entry.get<"arguments">().value(),
+                                 });
+    }
+
+    logging::info("Load module map successfully, {} files are cached", scan_results.size());
+}
+
+void ModuleGraph::save() {
+    ModuleMap map{ModuleMapVersion, {}};
+    map.entries.reserve(scan_results.size());
+    for(auto& [path, result]: scan_results) {
+        map.entries.emplace_back(path.str(),
+                                 result.info,
+                                 result.hash,
+                                 result.mtime,
+                                 result.arguments);
+    }
+
+    auto& cache_dir = config.project.cache_dir;
+    if(!fs::exists(cache_dir)) {
+        if(auto error = fs::create_directories(cache_dir)) {
+            logging::warn("Fail to create cache directory: {}", cache_dir);
+            return;
+        }
+    }
+
+    auto [buffer, proxy] = binary::serialize(map);
+
+    /// Write to a temporary file first, so that a broken file will never be loaded.
+    auto final_path = path::join(cache_dir, "modules.bin");
+    auto temp_path = final_path + ".tmp";
+    if(auto result = fs::write(temp_path, llvm::StringRef(buffer.data(), buffer.size()));
+       !result) {
+        logging::warn("Fail to write module map, because: {}", result.error());
+        return;
+    }
+
+    if(auto error = fs::rename(temp_path, final_path)) {
+        logging::warn("Fail to rename temporary file to module map: {}", error.message());
+        return;
+    }
+
+    logging::info("Save module map successfully");
+}
+
+async::Task<std::optional<ModuleGraph::ScanResult>> ModuleGraph::scan_file(std::string file) {
+    std::optional<ScanResult> cached;
+    if(auto it = scan_results.find(file); it != scan_results.end()) {
+        cached = it->second;
+    }
+
+    /// The result of preprocessing is outdated once the compile arguments are changed.
+    if(cached && cached->arguments != 0) {
+        auto arguments = database.get_command(file, command_options()).arguments;
+        if(cached->arguments != arguments_hash(arguments)) {
+            cached.reset();
+        }
+    }
+
+    /// Most files could be scanned by lexing, which is much cheaper than preprocessing.
+    bool need_preprocess = false;
+    auto result = co_await async::submit([&file, &cached, &need_preprocess] {
+        ScanResult result;
+        result.mtime = modification_time(file);
+        if(cached && cached->mtime == result.mtime) {
+            return std::move(*cached);
+        }
+
+        auto content = fs::read(file);
+        if(!content) {
+            return result;
+        }
+
+        /// The file is touched but its content is not changed.
+        result.hash = llvm::xxh3_64bits(*content);
+        if(cached && cached->hash == result.hash) {
+            result.info = std::move(cached->info);
+            result.arguments = cached->arguments;
+            return result;
+        }
+
+        if(auto info = scanModuleDirectives(*content)) {
+            result.info = std::move(*info);
+        } else {
+            need_preprocess = true;
+        }
+        return result;
+    });
+
+    if(need_preprocess) {
+        CompilationParams params;
+        params.kind = CompilationUnit::Preprocess;
+        params.arguments = database.get_command(file, command_options()).arguments;
+
+        auto info = co_await async::submit([&params] { return scanModule(params); });
+        if(!info) {
+            logging::warn("Fail to scan module for {}, because: {}", file, info.error());
+            co_return std::nullopt;
+        }
+
+        result.info = std::move(*info);
+        result.arguments = arguments_hash(params.arguments);
+    }
+
+    scan_results[file] = result;
+    co_return result;
+}
+
+async::Task<> ModuleGraph::scan() {
+    auto files = database.files();
+    logging::info("Start scanning modules for {} files", files.size());
+
+    std::vector<std::pair<std::string, ModuleInfo>> founds;
+
+    auto scan_one = [&](llvm::StringRef file) -> async::Task<bool> {
+        auto result = co_await scan_file(file.str());
+
+        /// Only interface units and partitions could be imported.
+        if(result) {
+            auto& info = result->info;
+            if(info.isInterfaceUnit || llvm::StringRef(info.name).contains(':')) {
+                founds.emplace_back(file.str(), std::move(info));
+            }
+        }
+
+        co_return true;
+    };
+
+    if(!files.empty()) {
+        co_await async::gather(files, scan_one);
+    }
+
+    /// Remove the scanning results of files no longer in the database.
+    llvm::StringSet<> in_database;
+    for(auto file: files) {
+        in_database.insert(file);
+    }
+
+    for(auto it = scan_results.begin(); it != scan_results.end();) {
+        auto current = it++;
+        if(!in_database.contains(current->first())) {
+            scan_results.erase(current);
+        }
+    }
+
+    llvm::StringSet<> seen;
+    for(auto& [path, info]: founds) {
+        if(!seen.insert(info.name).second) {
+            logging::warn("Module {} is declared in multiple files, ignore {}", info.name, path);
+            continue;
+        }
+
+        auto& unit = units[info.name];
+        if(!unit) {
+            unit = std::make_unique<ModuleUnit>();
+        }
+
+        /// The old PCM is outdated if the dependencies are changed.
+        if(unit->path != path || unit->info.mods != info.mods) {
+            unit->pcm.reset();
+        }
+
+        unit->path = std::move(path);
+        unit->info = std::move(info);
+        unit->cyclic = false;
+    }
+
+    /// Remove the modules that no longer exist. The building ones are
+    /// still referenced by their tasks, keep them until next scanning.
+    for(auto it = units.begin(); it != units.end();) {
+        auto current = it++;
+        if(!seen.contains(current->first()) && !current->second->building) {
+            units.erase(current);
+        }
+    }
+
+    compute_dependents();
+    check_cycles();
+
+    logging::info("Scanning modules successfully, found {} modules", units.size());
+
+    scanned = true;
+    scanned_event.set();
+    scanned_event.clear();
+}
+
+void ModuleGraph::compute_dependents() {
+    for(auto& [name, unit]: units) {
+        unit->dependents.clear();
+    }
+
+    for(auto& [name, unit]: units) {
+        for(auto& mod: unit->info.mods) {
+            if(auto dep = get(mod)) {
+                dep->dependents.emplace_back(name);
+            }
+        }
+    }
+}
+
+void ModuleGraph::check_cycles() {
+    enum class State : std::uint8_t {
+        Unvisited,
+        Visiting,
+        Visited,
+    };
+
+    llvm::StringMap<State> states;
+    llvm::SmallVector<ModuleUnit*> stack;
+
+    auto visit = [&](this auto& self, ModuleUnit* unit) -> void {
+        auto& state = states[unit->info.name];
+        if(state == State::Visited) {
+            return;
+        }
+
+        if(state == State::Visiting) {
+            /// All units on the stack after this unit form a cycle.
+            for(auto it = stack.rbegin(); it != stack.rend(); ++it) {
+                (*it)->cyclic = true;
+                if(*it == unit) {
+                    break;
+                }
+            }
+            logging::warn("Module {} is in an import cycle", unit->info.name);
+            return;
+        }
+
+        state = State::Visiting;
+        stack.push_back(unit);
+        for(auto& mod: unit->info.mods) {
+            if(auto dep = get(mod)) {
+                self(dep);
+            }
+        }
+        stack.pop_back();
+        state = State::Visited;
+    };
+
+    for(auto& [name, unit]: units) {
+        visit(unit.get());
+    }
+}
+
+void ModuleGraph::collect_pcms(llvm::StringRef name, llvm::StringMap<std::string>& pcms) {
+    auto unit = get(name);
+    if(!unit || !unit->pcm || pcms.contains(name)) {
+        return;
+    }
+
+    pcms.try_emplace(name, unit->pcm->path);
+    for(auto& mod: unit->info.mods) {
+        collect_pcms(mod, pcms);
+    }
+}
+
+async::Task<bool> ModuleGraph::build_all(std::vector<std::string> names) {
+    if(names.empty()) {
+        co_return true;
+    }
+
+    /// Always continue gathering even if some of them fail, so that the shared
+    /// building tasks will not be cancelled by others.
+    bool success = true;
+    co_await async::gather(names, [&](std::string& name) -> async::Task<bool> {
+        if(!co_await build(name)) {
+            success = false;
+        }
+        co_return true;
+    });
+    co_return success;
+}
+
+async::Task<bool> ModuleGraph::build(std::string name) {
+    auto unit = get(name);
+    if(!unit) {
+        logging::warn("Fail to find module {}", name);
+        co_return false;
+    }
+
+    if(unit->cyclic) {
+        logging::warn("Fail to build module {}, because it is in an import cycle", name);
+        co_return false;
+    }
+
+    /// If other task is building this module, just wait for it.
+    if(unit->building) {
+        co_await unit->built_event;
+        co_return unit->pcm.has_value();
+    }
+
+    if(unit->pcm && !unit->dirty && !unit->stale) {
+        co_return true;
+    }
+
+    unit->building = true;
+    auto finish = llvm::make_scope_exit([unit] {
+        unit->building = false;
+        unit->built_event.set();
+        unit->built_event.clear();
+    });
+
+    /// If fails, the PCM is unavailable now, which is also a change for dependents.
+    auto fail = [unit] {
+        unit->pcm.reset();
+        unit->dirty = false;
+        unit->stale = false;
+        unit->version += 1;
+        return false;
+    };
+
+    /// All dependencies must be built before this module, build them in parallel.
+    auto mods = unit->info.mods;
+    if(!co_await build_all(mods)) {
+        logging::warn("Fail to build module {}, because its dependencies fail to build", name);
+        co_return fail();
+    }
+
+    /// Early cutoff: if the files of this module are not changed and none of dependencies
+    /// changes its interface since the PCM was built, the PCM is still valid.
+    if(unit->pcm && !unit->dirty && ranges::all_of(mods, [&](const std::string& mod) {
+           auto dep = get(mod);
+           auto it = unit->built_versions.find(mod);
+           return !dep || (it != unit->built_versions.end() && it->second == dep->version);
+       })) {
+        unit->stale = false;
+        co_return true;
+    }
+
+    auto directory = path::join(config.project.cache_dir, "modules");
+    if(!fs::exists(directory)) {
+        if(auto error = fs::create_directories(directory)) {
+            logging::warn("Fail to create directory for PCM building: {}", directory);
+            co_return fail();
+        }
+    }
+
+    /// Partition name contains `:`, which is not allowed in file name on Windows.
+    std::string filename = name;
+    ranges::replace(filename, ':', '-');
+
+    /// The versions of dependencies this building is based on.
+    llvm::StringMap<std::uint64_t> versions;
+    for(auto& mod: mods) {
+        auto dep = get(mod);
+        versions[mod] = dep ? dep->version : 0;
+    }
+
+    CompilationParams params;
+    params.kind = CompilationUnit::ModuleInterface;
+    params.output_file = path::join(directory, filename + ".pcm");
+    params.arguments = database.get_command(unit->path, command_options()).arguments;
+    for(auto& mod: unit->info.mods) {
+        collect_pcms(mod, params.pcms);
+    }
+
+    logging::info("Start building PCM for {}", name);
+
+    PCMInfo pcm;
+    std::string message;
+    bool success = co_await async::submit([&params, &pcm, &message] {
+        /// PCM file is written until destructing, Add a single block for it.
+        auto unit = compile(params, pcm);
+        if(!unit) {
+            message = std::move(unit.error());
+            return false;
+        }
+        return true;
+    });
+
+    if(!success) {
+        logging::warn("Building PCM fails for {}, because: {}", name, message);
+        co_return fail();
+    }
+
+    logging::info("Building PCM successfully for {}", name);
+
+    /// Update the reverse map between files and modules.
+    if(unit->pcm) {
+        for(auto& dep: unit->pcm->deps) {
+            if(auto it = file_dependents.find(dep); it != file_dependents.end()) {
+                it->second.erase(name);
+            }
+        }
+    }
+
+    file_dependents[unit->path].insert(name);
+    for(auto& dep: pcm.deps) {
+        file_dependents[dep].insert(name);
+    }
+
+    if(!unit->pcm || unit->pcm->hash != pcm.hash) {
+        unit->version += 1;
+    }
+
+    unit->built_versions = std::move(versions);
+    unit->dirty = false;
+    unit->stale = false;
+    unit->pcm = std::move(pcm);
+    co_return true;
+}
+
+async::Task<std::vector<std::string>> ModuleGraph::update(std::string path) {
+    if(!scanned) {
+        co_await scanned_event;
+    }
+
+    /// If the module declaration or imports of the file are changed, the
+    /// structure of the graph is changed, scan the whole project again.
+    if(auto it = scan_results.find(path); it != scan_results.end()) {
+        auto old = it->second.info;
+        auto result = co_await scan_file(path);
+        if(result && (result->info.isInterfaceUnit != old.isInterfaceUnit ||
+                      result->info.name != old.name || result->info.mods != old.mods)) {
+            co_await scan();
+        }
+    }
+
+    auto it = file_dependents.find(path);
+    if(it == file_dependents.end()) {
+        co_return std::vector<std::string>();
+    }
+
+    /// The modules built from this file must be rebuilt, and all their transitive
+    /// dependents may need to be rebuilt.
+    llvm::SmallVector<ModuleUnit*> worklist;
+    for(auto& entry: it->second) {
+        if(auto unit = get(entry.getKey()); unit && unit->pcm) {
+            unit->dirty = true;
+            worklist.push_back(unit);
+        }
+    }
+
+    std::vector<std::string> affected;
+    llvm::StringSet<> visited;
+    while(!worklist.empty()) {
+        auto unit = worklist.pop_back_val();
+        if(!visited.insert(unit->info.name).second) {
+            continue;
+        }
+
+        affected.emplace_back(unit->info.name);
+        for(auto& name: unit->dependents) {
+            /// Modules not built yet will be built on demand.
+            if(auto dependent = get(name); dependent && dependent->pcm) {
+                dependent->stale = true;
+                worklist.push_back(dependent);
+            }
+        }
+    }
+
+    /// The changes are decided by versions, other updates running at the same time may
+    /// also build these modules, their changes are observed here too.
+    llvm::StringMap<std::uint64_t> versions;
+    for(auto& name: affected) {
+        versions[name] = get(name)->version;
+    }
+
+    co_await build_all(affected);
+
+    std::vector<std::string> changed;
+    for(auto& name: affected) {
+        if(auto unit = get(name); unit && unit->version != versions[name]) {
+            changed.emplace_back(name);
+        }
+    }
+
+    logging::info("Update modules for {}, {} affected, {} changed",
+                  path,
+                  affected.size(),
+                  changed.size());
+    co_return changed;
+}
+
+async::Task<bool> ModuleGraph::resolve(std::string path,
+                                       std::string content,
+                                       llvm::StringMap<std::string>& pcms) {
+    if(!scanned) {
+        co_await scanned_event;
+    }
+
+    auto info = co_await async::submit([&content] { return scanModuleDirectives(content); });
+    if(!info) {
+        CompilationParams params;
+        params.kind = CompilationUnit::Preprocess;
+        params.arguments = database.get_command(path, command_options()).arguments;
+        params.add_remapped_file(path, content);
+
+        auto result = co_await async::submit([&params] { return scanModule(params); });
+        if(!result) {
+            logging::warn("Fail to scan module for {}, because: {}", path, result.error());
+            co_return false;
+        }
+
+        info = std::move(*result);
+    }
+
+    auto mods = imported_modules(*info);
+    bool success = co_await build_all(mods);
+    for(auto& mod: mods) {
+        collect_pcms(mod, pcms);
+    }
+    co_return success;
+}
+
+async::Task<bool> ModuleGraph::resolve(std::string path, llvm::StringMap<std::string>& pcms) {
+    if(!scanned) {
+        co_await scanned_event;
+    }
+
+    auto result = co_await scan_file(path);
+    if(!result) {
+        co_return false;
+    }
+
+    auto mods = imported_modules(result->info);
+    bool success = co_await build_all(mods);
+    for(auto& mod: mods) {
+        collect_pcms(mod, pcms);
+    }
+    co_return success;
+}
+
+}  // namespace clice
@@ -115,7 +115,20 @@ Server::Server() {
     register_callback<&Server::on_document_range_format>("textDocument/rangeFormatting");
     register_callback<&Server::on_folding_range>("textDocument/foldingRange");
     register_callback<&Server::on_semantic_token>("textDocument/semanticTokens/full");
+    register_callback<&Server::on_semantic_token_delta>("textDocument/semanticTokens/full/delta");
+    register_callback<&Server::on_semantic_token_range>("textDocument/semanticTokens/range");
     register_callback<&Server::on_inlay_hint>("textDocument/inlayHint");
+    register_callback<&Server::on_workspace_symbol>("workspace/symbol");
+    register_callback<&Server::on_definition>("textDocument/definition");
+    register_callback<&Server::on_declaration>("textDocument/declaration");
+    register_callback<&Server::on_implementation>("textDocument/implementation");
+    register_callback<&Server::on_references>("textDocument/references");
+    register_callback<&Server::on_prepare_call_hierarchy>("textDocument/prepareCallHierarchy");
+    register_callback<&Server::on_incoming_calls>("callHierarchy/incomingCalls");
+    register_callback<&Server::on_outgoing_calls>("callHierarchy/outgoingCalls");
+    register_callback<&Server::on_prepare_type_hierarchy>("textDocument/prepareTypeHierarchy");
+    register_callback<&Server::on_supertypes>("typeHierarchy/supertypes");
+    register_callback<&Server::on_subtypes>("typeHierarchy/subtypes");
 }
 
 async::Task<> Server::on_receive(json::Value value) {
@@ -141,6 +154,9 @@ async::Task<> Server::on_receive(json::Value value) {
         co_return;
     }
 
+    /// Give way to the client, background indexing continues when it is idle.
+    indexer.pause_background();
+
     json::Value params = json::Value(nullptr);
     if(auto result = object->get("params")) {
         params = std::move(*result);
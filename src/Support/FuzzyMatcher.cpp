@@ -50,6 +50,10 @@
 #include "Support/FuzzyMatcher.h"
 #include "llvm/Support/Format.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 namespace clice {
 
 static char lower(char C) {
@@ -86,6 +90,22 @@ FuzzyMatcher::FuzzyMatcher(llvm::StringRef pattern) :
 
     pat_type_set =
         calculate_roles(llvm::StringRef(Pat, pat_n), llvm::MutableArrayRef(pat_role, pat_n));
+    pat_set = char_set(llvm::StringRef(Pat, pat_n));
+}
+
+// Each lowercase letter, digit and underscore has its own bit, other characters
+// share the remaining bits, so the set may have false positives but no false negatives.
+std::uint64_t FuzzyMatcher::char_set(llvm::StringRef Word) {
+    std::uint64_t Set = 0;
+    for(unsigned char C: Word.take_front(MaxWord)) {
+        C = lower(C);
+        unsigned Bit = C >= 'a' && C <= 'z'   ? C - 'a'
+                       : C >= '0' && C <= '9' ? 26 + (C - '0')
+                       : C == '_'             ? 36
+                                              : 37 + C % 27;
+        Set |= std::uint64_t(1) << Bit;
+    }
+    return Set;
 }
 
 std::optional<float> FuzzyMatcher::match(llvm::StringRef word) {
@@ -202,7 +222,22 @@ bool FuzzyMatcher::init(llvm::StringRef new_word) {
         return true;
     }
 
-    for(int I = 0; I < word_n; ++I) {
+    int I = 0;
+#if defined(__SSE2__)
+    // Lowercase 16 characters at once, bytes over 127 are negative so that
+    // they are never in range.
+    const __m128i BeforeA = _mm_set1_epi8('A' - 1);
+    const __m128i AfterZ = _mm_set1_epi8('Z' + 1);
+    const __m128i CaseBit = _mm_set1_epi8('a' - 'A');
+    for(; I + 16 <= word_n; I += 16) {
+        __m128i Chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(word + I));
+        __m128i Upper =
+            _mm_and_si128(_mm_cmpgt_epi8(Chars, BeforeA), _mm_cmplt_epi8(Chars, AfterZ));
+        Chars = _mm_add_epi8(Chars, _mm_and_si128(Upper, CaseBit));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(low_word + I), Chars);
+    }
+#endif
+    for(; I < word_n; ++I) {
         low_word[I] = lower(word[I]);
     }
 
@@ -0,0 +1,72 @@
+#include <algorithm>
+#include "Support/LineTable.h"
+
+namespace clice {
+
+LineTable::LineTable(llvm::StringRef content) : text(content) {
+    /// `find` is backed by `memchr`, which is vectorized by the C library.
+    for(auto pos = content.find('\n'); pos != llvm::StringRef::npos;
+        pos = content.find('\n', pos + 1)) {
+        starts.push_back(pos + 1);
+    }
+
+    /// Without early exit, the compiler vectorizes the loop to check the high bits.
+    unsigned char bits = 0;
+    for(auto c: content) {
+        bits |= static_cast<unsigned char>(c);
+    }
+    ascii = !(bits & 0x80);
+}
+
+llvm::StringRef LineTable::line_content(std::uint32_t line) const {
+    auto begin = starts[line];
+    auto end = line + 1 < starts.size() ? starts[line + 1] - 1 : text.size();
+    return text.slice(begin, end);
+}
+
+std::uint32_t LineTable::line(std::uint32_t offset) const {
+    auto it = std::upper_bound(starts.begin(), starts.end(), offset);
+    return it - starts.begin() - 1;
+}
+
+std::pair<std::uint32_t, std::uint32_t>
+    LineTable::to_position(std::uint32_t offset, PositionEncodingKind encoding) const {
+    assert(offset <= text.size() && "Offset is out of range");
+
+    auto [line, column] = position(offset);
+    if(ascii || encoding == PositionEncodingKind::UTF8) {
+        return {line, column};
+    }
+
+    auto begin = starts[line];
+    return {line, remeasure(text.slice(begin, offset), encoding)};
+}
+
+std::uint32_t LineTable::to_offset(std::uint32_t line,
+                                   std::uint32_t column,
+                                   PositionEncodingKind encoding) const {
+    if(line >= starts.size()) {
+        return text.size();
+    }
+
+    auto begin = starts[line];
+    auto content = line_content(line);
+    if(ascii || encoding == PositionEncodingKind::UTF8) {
+        return begin + std::min<std::uint32_t>(column, content.size());
+    }
+
+    std::uint32_t offset = begin;
+    iterateCodepoints(content, [&](std::uint32_t utf8_length, std::uint32_t utf16_length) {
+        auto length = encoding == PositionEncodingKind::UTF16 ? utf16_length : 1;
+        if(column < length) {
+            return false;
+        }
+
+        column -= length;
+        offset += utf8_length;
+        return column != 0;
+    });
+    return offset;
+}
+
+}  // namespace clice
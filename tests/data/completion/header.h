@@ -0,0 +1,9 @@
+#pragma once
+
+int completion_global(int value);
+
+namespace demo {
+
+int completion_target(int value);
+
+}
@@ -0,0 +1,5 @@
+int completion_local = 0;
+
+int main() {
+    return completion_
+}
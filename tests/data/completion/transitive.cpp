@@ -0,0 +1,5 @@
+#include "wrapper.h"
+
+int transitive() {
+    return completion_
+}
@@ -0,0 +1,5 @@
+#include "header.h"
+
+int user() {
+    return demo::completion_target(1);
+}
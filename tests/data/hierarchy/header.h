@@ -0,0 +1,7 @@
+#pragma once
+
+struct HierarchyBase {
+    virtual ~HierarchyBase() = default;
+};
+
+int hierarchy_callee(int value);
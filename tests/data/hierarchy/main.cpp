@@ -0,0 +1,11 @@
+#include "header.h"
+
+struct HierarchyDerived : HierarchyBase {};
+
+int hierarchy_callee(int value) {
+    return value + 1;
+}
+
+int hierarchy_caller() {
+    return hierarchy_callee(1);
+}
@@ -0,0 +1,3 @@
+#pragma once
+
+int lookup_target(int value);
@@ -0,0 +1,9 @@
+#include "header.h"
+
+int lookup_target(int value) {
+    return value + 1;
+}
+
+int lookup_caller() {
+    return lookup_target(1);
+}
@@ -0,0 +1,20 @@
+import asyncio
+from typing import Awaitable, Callable
+
+import pytest
+
+
+def position(content: str, text: str, line_text: str | None = None):
+    """The position of `text` in the first line containing `line_text` (default `text`)."""
+    lines = content.splitlines()
+    line = next(i for i, line in enumerate(lines) if (line_text or text) in line)
+    return {"line": line, "character": lines[line].index(text)}
+
+
+async def wait_until(check: Callable[[], Awaitable[bool]], message: str, timeout: int = 30):
+    """Call `check` every second until it returns true, fail the test after `timeout` seconds."""
+    for _ in range(0, timeout):
+        if await check():
+            return
+        await asyncio.sleep(1)
+    pytest.fail(message)
@@ -0,0 +1,82 @@
+import pytest
+from tests.fixtures.client import LSPClient
+from tests.fixtures.utils import wait_until
+
+
+async def complete(client: LSPClient, relative_path: str, token: str | None = None):
+    content = client.get_file(relative_path).content
+    line = content.splitlines().index("    return completion_")
+    params = {
+        "textDocument": {"uri": client.get_abs_path(relative_path).as_uri()},
+        "position": {"line": line, "character": len("    return completion_")},
+    }
+    if token:
+        params["partialResultToken"] = token
+    return await client.send_request("textDocument/completion", params)
+
+
+def labels(items):
+    return [item["label"] for item in items]
+
+
+async def wait_indexed(client: LSPClient, relative_path: str):
+    # Wait until `header.h` is indexed from `user.cpp`.
+    async def indexed():
+        result = await complete(client, relative_path)
+        return "completion_target" in labels(result["items"])
+
+    await wait_until(indexed, "header.h is not indexed")
+
+
+async def complete_with_progress(client: LSPClient, relative_path: str):
+    progress = []
+    client.register_notification_handler(
+        "$/progress",
+        lambda params: progress.append(params["value"])
+        if params and params["token"] == "completion"
+        else None,
+    )
+
+    result = await complete(client, relative_path, "completion")
+    assert result == []
+    return progress
+
+
+@pytest.mark.asyncio
+async def test_index_completion_reported_after_sema(client: LSPClient, test_data_dir):
+    await client.initialize(test_data_dir / "completion")
+    await client.did_open("user.cpp")
+    await client.did_open("main.cpp")
+    await wait_indexed(client, "main.cpp")
+
+    progress = await complete_with_progress(client, "main.cpp")
+    assert len(progress) == 2
+
+    # The Sema items come first, the list carries the real incompleteness.
+    sema = progress[0]
+    assert not sema["isIncomplete"]
+    assert "completion_local" in labels(sema["items"])
+    assert "completion_target" not in labels(sema["items"])
+
+    # Then the index items requiring an `#include` are appended.
+    index = progress[1]
+    assert sorted(labels(index)) == ["completion_global", "completion_target"]
+    assert all(item["additionalTextEdits"] for item in index)
+
+
+@pytest.mark.asyncio
+async def test_index_completion_skips_visible_names(client: LSPClient, test_data_dir):
+    await client.initialize(test_data_dir / "completion")
+    await client.did_open("user.cpp")
+    await client.did_open("transitive.cpp")
+    await wait_indexed(client, "transitive.cpp")
+
+    progress = await complete_with_progress(client, "transitive.cpp")
+
+    # `completion_global` is visible through `wrapper.h`, so only Sema offers it.
+    sema = progress[0]
+    assert labels(sema["items"]).count("completion_global") == 1
+
+    index = [item for value in progress[1:] for item in value]
+    assert "completion_global" not in labels(index)
+    assert "completion_target" in labels(index)
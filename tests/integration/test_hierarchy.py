@@ -0,0 +1,93 @@
+import pytest
+from tests.fixtures.client import LSPClient
+from tests.fixtures.utils import position, wait_until
+
+
+async def prepare(client: LSPClient, method: str, pos):
+    params = {
+        "textDocument": {"uri": client.get_abs_path("main.cpp").as_uri()},
+        "position": pos,
+    }
+    return await client.send_request(method, params)
+
+
+def summary(item):
+    """The name, file name and selection start of a hierarchy item."""
+    start = item["selectionRange"]["start"]
+    return (item["name"], item["uri"].rsplit("/", 1)[-1], start["line"], start["character"])
+
+
+def starts(ranges):
+    return [(item["start"]["line"], item["start"]["character"]) for item in ranges]
+
+
+async def open_edited(client: LSPClient, test_data_dir):
+    """Open `main.cpp`, wait until it is indexed and then shift its lines without saving."""
+    await client.initialize(test_data_dir / "hierarchy")
+    await client.did_open("main.cpp")
+
+    # The base class in `header.h` is only found once `main.cpp` is indexed.
+    content = client.get_file("main.cpp").content
+    derived = position(content, "HierarchyDerived")
+
+    async def indexed():
+        items = await prepare(client, "textDocument/prepareTypeHierarchy", derived)
+        if not items:
+            return False
+        supertypes = await client.send_request("typeHierarchy/supertypes", {"item": items[0]})
+        return bool(supertypes)
+
+    await wait_until(indexed, "main.cpp is not indexed")
+
+    content = "// edited\n\n" + content
+    await client.did_change("main.cpp", content)
+    return content
+
+
+@pytest.mark.asyncio
+async def test_call_hierarchy(client: LSPClient, test_data_dir):
+    content = await open_edited(client, test_data_dir)
+    call = position(content, "hierarchy_callee", "return hierarchy_callee")
+    callee = position(content, "hierarchy_callee", "int hierarchy_callee")
+    caller = position(content, "hierarchy_caller")
+
+    items = await prepare(client, "textDocument/prepareCallHierarchy", call)
+    assert [summary(item) for item in items] == [
+        ("hierarchy_callee", "main.cpp", callee["line"], callee["character"]),
+    ]
+
+    incoming = await client.send_request("callHierarchy/incomingCalls", {"item": items[0]})
+    assert [summary(entry["from"]) for entry in incoming] == [
+        ("hierarchy_caller", "main.cpp", caller["line"], caller["character"]),
+    ]
+    assert starts(incoming[0]["fromRanges"]) == [(call["line"], call["character"])]
+
+    items = await prepare(client, "textDocument/prepareCallHierarchy", caller)
+    outgoing = await client.send_request("callHierarchy/outgoingCalls", {"item": items[0]})
+    assert [summary(entry["to"]) for entry in outgoing] == [
+        ("hierarchy_callee", "main.cpp", callee["line"], callee["character"]),
+    ]
+    assert starts(outgoing[0]["fromRanges"]) == [(call["line"], call["character"])]
+
+
+@pytest.mark.asyncio
+async def test_type_hierarchy(client: LSPClient, test_data_dir):
+    content = await open_edited(client, test_data_dir)
+    derived = position(content, "HierarchyDerived")
+    header = client.get_abs_path("header.h").read_text(encoding="utf-8")
+    base = position(header, "HierarchyBase", "struct HierarchyBase")
+
+    items = await prepare(client, "textDocument/prepareTypeHierarchy", derived)
+    assert [summary(item) for item in items] == [
+        ("HierarchyDerived", "main.cpp", derived["line"], derived["character"]),
+    ]
+
+    supertypes = await client.send_request("typeHierarchy/supertypes", {"item": items[0]})
+    assert [summary(item) for item in supertypes] == [
+        ("HierarchyBase", "header.h", base["line"], base["character"]),
+    ]
+
+    subtypes = await client.send_request("typeHierarchy/subtypes", {"item": supertypes[0]})
+    assert [summary(item) for item in subtypes] == [
+        ("HierarchyDerived", "main.cpp", derived["line"], derived["character"]),
+    ]
@@ -0,0 +1,97 @@
+import pytest
+from tests.fixtures.client import LSPClient
+from tests.fixtures.utils import position, wait_until
+
+
+async def lookup(client: LSPClient, method: str, relative_path: str, pos):
+    params = {
+        "textDocument": {"uri": client.get_abs_path(relative_path).as_uri()},
+        "position": pos,
+    }
+    if method == "textDocument/references":
+        params["context"] = {"includeDeclaration": True}
+    return await client.send_request(method, params)
+
+
+def locations(result):
+    """The file name and start position of the locations, sorted."""
+    return sorted(
+        (
+            location["uri"].rsplit("/", 1)[-1],
+            location["range"]["start"]["line"],
+            location["range"]["start"]["character"],
+        )
+        for location in result or []
+    )
+
+
+async def wait_indexed(client: LSPClient, pos):
+    # The declaration in `header.h` is only found once `main.cpp` is indexed.
+    async def indexed():
+        result = await lookup(client, "textDocument/references", "main.cpp", pos)
+        return any(name == "header.h" for name, _, _ in locations(result))
+
+    await wait_until(indexed, "main.cpp is not indexed")
+
+
+@pytest.mark.asyncio
+async def test_lookup_unsaved_edit(client: LSPClient, test_data_dir):
+    await client.initialize(test_data_dir / "lookup")
+    await client.did_open("main.cpp")
+
+    content = client.get_file("main.cpp").content
+    await wait_indexed(client, position(content, "lookup_target", "return lookup_target"))
+
+    # Shift the lines without saving, the stored index still has the old content.
+    content = "// edited\n\n" + content
+    await client.did_change("main.cpp", content)
+    call = position(content, "lookup_target", "return lookup_target")
+    definition = position(content, "lookup_target", "int lookup_target")
+
+    result = await lookup(client, "textDocument/definition", "main.cpp", call)
+    assert locations(result) == [
+        ("main.cpp", definition["line"], definition["character"]),
+    ]
+
+    header = client.get_abs_path("header.h").read_text(encoding="utf-8")
+    declaration = position(header, "lookup_target")
+    result = await lookup(client, "textDocument/references", "main.cpp", call)
+    assert locations(result) == [
+        ("header.h", declaration["line"], declaration["character"]),
+        ("main.cpp", definition["line"], definition["character"]),
+        ("main.cpp", call["line"], call["character"]),
+    ]
+
+
+@pytest.mark.asyncio
+async def test_workspace_symbol(client: LSPClient, test_data_dir):
+    await client.initialize(test_data_dir / "lookup")
+    await client.did_open("main.cpp")
+
+    async def search():
+        result = await client.send_request("workspace/symbol", {"query": "lookup_tar"})
+        return sorted(
+            (
+                symbol["name"],
+                symbol["location"]["uri"].rsplit("/", 1)[-1],
+                symbol["location"]["range"]["start"]["line"],
+                symbol["location"]["range"]["start"]["character"],
+            )
+            for symbol in result or []
+        )
+
+    # The names are searchable once `main.cpp` and `header.h` are indexed.
+    async def indexed():
+        files = {file for _, file, _, _ in await search()}
+        return files == {"header.h", "main.cpp"}
+
+    await wait_until(indexed, "main.cpp is not indexed")
+
+    content = client.get_file("main.cpp").content
+    definition = position(content, "lookup_target", "int lookup_target")
+    header = client.get_abs_path("header.h").read_text(encoding="utf-8")
+    declaration = position(header, "lookup_target")
+    assert await search() == [
+        ("lookup_target", "header.h", declaration["line"], declaration["character"]),
+        ("lookup_target", "main.cpp", definition["line"], definition["character"]),
+    ]
@@ -0,0 +1,62 @@
+#include "Test/Tester.h"
+#include "AST/FilterASTVisitor.h"
+
+namespace clice::testing {
+
+namespace {
+
+/// Collect the names of functions, stop after `limit` functions are collected.
+class FunctionCollector : public FilteredASTVisitor<FunctionCollector> {
+public:
+    FunctionCollector(CompilationUnit& unit,
+                      std::size_t limit = std::numeric_limits<std::size_t>::max()) :
+        FilteredASTVisitor(unit, true), limit(limit) {}
+
+    bool VisitFunctionDecl(const clang::FunctionDecl* decl) {
+        names.emplace_back(decl->getNameAsString());
+        return names.size() < limit;
+    }
+
+    std::size_t limit;
+    std::vector<std::string> names;
+};
+
+suite<"FusedASTVisitor"> fused_ast_visitor = [] {
+    test("StopEarly") = [] {
+        Tester tester;
+        tester.add_main("main.cpp", R"cpp(
+void a() {}
+void b() {}
+void c() {}
+)cpp");
+        expect(that % tester.compile());
+
+        auto& unit = *tester.unit;
+        std::vector<std::string> all = {"a", "b", "c"};
+
+        /// The stopped visitor isn't called any more, while others continue.
+        FunctionCollector first(unit, 1);
+        FunctionCollector second(unit);
+        expect(that % FusedASTVisitor(unit, true, first, second).TraverseDecl(unit.tu()));
+        expect(that % first.names == std::vector<std::string>{"a"});
+        expect(that % second.names == all);
+
+        /// The order of visitors doesn't matter.
+        FunctionCollector third(unit);
+        FunctionCollector fourth(unit, 2);
+        expect(that % FusedASTVisitor(unit, true, third, fourth).TraverseDecl(unit.tu()));
+        expect(that % third.names == all);
+        expect(that % fourth.names == std::vector<std::string>{"a", "b"});
+
+        /// The traversal is aborted if all visitors are stopped.
+        FunctionCollector fifth(unit, 1);
+        FunctionCollector sixth(unit, 2);
+        expect(that % !FusedASTVisitor(unit, true, fifth, sixth).TraverseDecl(unit.tu()));
+        expect(that % fifth.names == std::vector<std::string>{"a"});
+        expect(that % sixth.names == std::vector<std::string>{"a", "b"});
+    };
+};
+
+}  // namespace
+
+}  // namespace clice::testing
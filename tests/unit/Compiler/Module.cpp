@@ -117,9 +117,102 @@ import C;
 export module A;
 )";
         auto pcm = buildPCM("A.ixx", content);
-        // expect(that % pcm.isInterfaceUnit == true);
-        // expect(that % pcm.name == "A");
-        // expect(that % pcm.mods.size() == 0);
+        expect(that % pcm.isInterfaceUnit == true);
+        expect(that % pcm.name == "A"sv);
+        expect(that % pcm.mods.size() == 0);
+    };
+
+    test("InterfaceHash") = [&] {
+        auto hash = [&](llvm::StringRef content) {
+            return buildPCM("A.ixx", content).hash;
+        };
+
+        auto origin = hash(R"(
+export module A;
+export int foo() { return 1; }
+export inline int bar() { return 1; }
+)");
+
+        /// Change the body of non-inline function doesn't affect importers.
+        expect(that % origin == hash(R"(
+export module A;
+export int foo() { return 2; }
+export inline int bar() { return 1; }
+)"));
+
+        /// Change the body of inline function affects importers.
+        expect(that % origin != hash(R"(
+export module A;
+export int foo() { return 1; }
+export inline int bar() { return 2; }
+)"));
+
+        /// Change the signature of function affects importers.
+        expect(that % origin != hash(R"(
+export module A;
+export int foo(int x) { return 1; }
+export inline int bar() { return 1; }
+)"));
+    };
+
+    test("ScanDirectives") = [&] {
+        auto info = scanModuleDirectives(R"(
+module;
+#include "test.h"
+export module A:B;
+import C;
+export import :D;
+import <vector>;
+module :private;
+)");
+        expect(that % info.has_value());
+        expect(that % info->isInterfaceUnit == true);
+        expect(that % info->name == "A:B"sv);
+        expect(that % info->mods.size() == 2);
+        expect(that % info->mods[0] == "C"sv);
+        expect(that % info->mods[1] == "A:D"sv);
+
+        info = scanModuleDirectives(R"(
+module A.B;
+import C.D;
+)");
+        expect(that % info.has_value());
+        expect(that % info->isInterfaceUnit == false);
+        expect(that % info->name == "A.B"sv);
+        expect(that % info->mods.size() == 1);
+        expect(that % info->mods[0] == "C.D"sv);
+
+        /// Not a module unit.
+        info = scanModuleDirectives(R"(
+#include <vector>
+import A;
+int import = 1;
+)");
+        expect(that % info.has_value());
+        expect(that % info->name.empty());
+        expect(that % info->mods.size() == 1);
+        expect(that % info->mods[0] == "A"sv);
+
+        /// Module declaration in condition directive, need preprocess.
+        info = scanModuleDirectives(R"(
+#ifdef TEST
+export module A;
+#else
+export module B;
+#endif
+)");
+        expect(that % !info.has_value());
+
+        /// Condition directives before module declaration don't matter.
+        info = scanModuleDirectives(R"(
+module;
+#ifdef TEST
+#include <vector>
+#endif
+export module A;
+)");
+        expect(that % info.has_value());
+        expect(that % info->name == "A"sv);
     };
 };
 
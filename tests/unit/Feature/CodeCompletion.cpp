@@ -7,16 +7,18 @@ namespace {
 
 suite<"CodeCompletion"> code_completion = [] {
     std::vector<feature::CompletionItem> items;
+    bool incomplete = false;
 
-    auto code_complete = [&](llvm::StringRef code) {
+    auto code_complete = [&](llvm::StringRef code, config::CodeCompletionOption options = {}) {
         CompilationParams params;
         auto annotation = AnnotatedSource::from(code);
         params.arguments = {"clang++", "-std=c++20", "main.cpp"};
         params.completion = {"main.cpp", annotation.offsets["pos"]};
         params.add_remapped_file("main.cpp", annotation.content);
 
-        config::CodeCompletionOption options = {};
-        items = feature::code_complete(params, options);
+        auto result = feature::code_complete(params, options);
+        items = std::move(result.items);
+        incomplete = result.incomplete;
     };
 
     using enum feature::CompletionItemKind;
@@ -31,6 +33,58 @@ int x = fo$(pos)
         expect(items.front().kind == Function);
     };
 
+    test("Filter") = [&] {
+        llvm::StringRef code = R"cpp(
+int foooo = 1;
+int fobar = 2;
+int x = fo$(pos)
+)cpp";
+        code_complete(code);
+
+        auto contains = [&](llvm::StringRef label) {
+            return ranges::any_of(items, [&](auto& item) { return item.label == label; });
+        };
+        expect(that % contains("foooo"));
+        expect(that % contains("fobar"));
+
+        /// Continue typing, filter the last result with the new prefix.
+        auto annotation = AnnotatedSource::from(code);
+        auto offset = annotation.offsets["pos"];
+        std::string content = annotation.content;
+        content.insert(offset, "o");
+
+        items = feature::filter_completion(items, content, offset + 1);
+        expect(that % contains("foooo"));
+        expect(that % !contains("fobar"));
+
+        auto range = feature::completion_prefix(content, offset + 1);
+        expect(that % range.begin == offset - 2);
+        for(auto& item: items) {
+            expect(that % item.edit.range.begin == range.begin);
+            expect(that % item.edit.range.end == range.end);
+        }
+    };
+
+    test("Limit") = [&] {
+        llvm::StringRef code = R"cpp(
+int foo_bar_baz = 1;
+int foooo = 2;
+int foo = 3;
+int x = foo$(pos)
+)cpp";
+        code_complete(code, {.limit = 2});
+        expect(that % items.size() == 2);
+        expect(that % incomplete);
+
+        /// Only the best items are kept, and sorted by score.
+        expect(that % items[0].label == "foo");
+        expect(that % items[0].score >= items[1].score);
+
+        code_complete(code, {.limit = 3});
+        expect(that % items.size() == 3);
+        expect(that % !incomplete);
+    };
+
     test("Snippet") = [&] {
         code_complete(R"cpp(
 int x = tru$(pos)
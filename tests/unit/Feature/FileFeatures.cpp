@@ -0,0 +1,56 @@
+#include "Test/Tester.h"
+#include "Feature/FileFeatures.h"
+#include "Support/Compare.h"
+
+namespace clice::testing {
+
+namespace {
+
+suite<"FileFeatures"> file_features = [] {
+    test("Fused") = [] {
+        const char* main = R"cpp(
+namespace ns {
+
+struct Foo {
+    int x;
+
+public:
+    void bar(int a,
+             int b) {
+        auto lambda = [&](int c) {
+            return c + 1;
+        };
+    }
+};
+
+}  // namespace ns
+
+#pragma region test
+int main() {
+    ns::Foo foo{
+        1,
+    };
+}
+#pragma endregion
+)cpp";
+
+        Tester tester;
+        tester.add_main("main.cpp", main);
+        tester.compile_with_pch();
+        expect(that % tester.unit.has_value());
+
+        /// The fused traversal produces the same results with separate ones.
+        auto& unit = *tester.unit;
+        auto features = feature::file_features(unit);
+        expect(that % !features.folding_ranges.empty());
+        expect(that % !features.document_symbols.empty());
+        expect(that % refl::equal(features.folding_ranges, feature::folding_ranges(unit)));
+        expect(that % refl::equal(features.document_symbols, feature::document_symbols(unit)));
+        expect(that % refl::equal(features.semantic_tokens, feature::semantic_tokens(unit)));
+        expect(that % refl::equal(features.document_links, feature::document_links(unit)));
+    };
+};
+
+}  // namespace
+
+}  // namespace clice::testing
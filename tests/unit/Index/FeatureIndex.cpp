@@ -0,0 +1,87 @@
+#include "Test/Tester.h"
+#include "Index/FeatureIndex.h"
+
+namespace clice::testing {
+
+namespace {
+
+suite<"FeatureIndex"> feature_index = [] {
+    test("Lazy") = [] {
+        Tester tester;
+        tester.add_files("main.cpp", R"cpp(
+#[test.h]
+
+#[main.cpp]
+#include "test.h"
+
+namespace ns {
+
+struct Foo {
+    void bar() {
+        int x = 1;
+    }
+
+    void baz() {
+        @viewport[int y = 2;]
+    }
+};
+
+}  // namespace ns
+)cpp");
+        tester.compile();
+        expect(that % tester.unit.has_value());
+
+        auto& unit = *tester.unit;
+        auto indices = index::FeatureIndex::build(unit);
+        auto& buffer = indices[unit.interested_file()];
+        index::FeatureIndex index(buffer.data(), buffer.size());
+
+        /// The lazy views see the same data with the deserialized ones.
+        auto tokens = index.semanticTokens();
+        expect(that % !tokens.empty());
+        expect(that % refl::equal(std::vector(index.tokens().begin(), index.tokens().end()),
+                                  tokens));
+
+        auto foldings = index.foldingRanges();
+        expect(that % !foldings.empty());
+        expect(that % index.foldings().length() == foldings.size());
+        for(std::uint32_t i = 0; i < foldings.size(); ++i) {
+            expect(that % index.foldings()[i].range() == foldings[i].range);
+            expect(that % index.foldings()[i].text() == foldings[i].text);
+        }
+
+        auto links = index.links();
+        expect(that % links.length() == 1);
+        expect(that % links[0].file() == index.documentLinks()[0].file);
+
+        auto symbols = index.symbols();
+        expect(that % symbols.length() == 1);
+        expect(that % symbols[0].name() == "ns");
+        expect(that % symbols[0].children()[0].name() == "Foo");
+        expect(that % symbols[0].children()[0].children().length() == 2);
+        expect(that % symbols[0].children()[0].children()[1].name() == "baz");
+
+        /// Only the tokens begin in the range are selected.
+        auto range = tester.range("viewport", "main.cpp");
+        auto selected = index.tokens(range);
+        std::size_t expected = std::ranges::count_if(tokens, [&](const feature::SemanticToken& token) {
+            return token.range.begin >= range.begin && token.range.begin < range.end;
+        });
+        expect(that % !selected.empty());
+        expect(that % selected.size() == expected);
+        expect(that % selected.front().range.begin >= range.begin);
+        expect(that % index.tokens({0, 0}).empty());
+
+        /// The foldings of namespace, class and `baz` enclose the range, `bar` does not.
+        auto enclosing = index.foldings(range);
+        expected = std::ranges::count_if(foldings, [&](const feature::FoldingRange& folding) {
+            return folding.range.intersects(range);
+        });
+        expect(that % enclosing.size() == expected);
+        expect(that % enclosing.size() < foldings.size());
+    };
+};
+
+}  // namespace
+
+}  // namespace clice::testing
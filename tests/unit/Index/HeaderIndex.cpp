@@ -43,10 +43,14 @@ auto dump = [](HeaderIndex& index, DumpConfig config) {
             std::println("symbol: {}, kind: {}", symbol.name, symbol.kind.name());
             for(auto& relation: symbol.relations) {
                 if(relation.ctx.is_dependent()) {
-                    auto context = index.dependent_elem_states[relation.ctx.offset()];
-                    std::println("   kind: {}, context: {:#b}",
+                    std::string context;
+                    index.dependent_elem_states[relation.ctx.offset()].for_each([&](auto id) {
+                        context += std::format("{} ", id);
+                        return true;
+                    });
+                    std::println("   kind: {}, context: {}",
                                  relation.kind.name(),
-                                 context.to_ulong());
+                                 context);
                 }
             }
         }
@@ -58,10 +62,14 @@ auto dump = [](HeaderIndex& index, DumpConfig config) {
             std::println("occurrence: {} {}", range.begin, range.end);
             for(auto& occurrence: occurrences) {
                 if(occurrence.ctx.is_dependent()) {
-                    auto context = index.dependent_elem_states[occurrence.ctx.offset()];
-                    std::println("   target: {}, context: {:#b}",
+                    std::string context;
+                    index.dependent_elem_states[occurrence.ctx.offset()].for_each([&](auto id) {
+                        context += std::format("{} ", id);
+                        return true;
+                    });
+                    std::println("   target: {}, context: {}",
                                  occurrence.target_symbol,
-                                 context.to_ulong());
+                                 context);
                 }
             }
         }
@@ -826,6 +834,73 @@ suite<"HeaderIndex"> header_index = [] {
             expect(refl::equal(context, HeaderIndex::HeaderContext{226, 9, 3}));
         }
     };
+
+    test("ContextSet") = [] {
+        /// The set switches to dense and back to sparse, the ids are kept across switching.
+        index::ContextSet set;
+        for(std::uint32_t id = 0; id < 100; ++id) {
+            set.set(id * 3);
+        }
+        expect(that % set.count() == 100);
+
+        for(std::uint32_t id = 5; id < 100; ++id) {
+            set.reset(id * 3);
+        }
+        expect(that % set.count() == 5);
+        expect(that % set.test(12));
+        expect(that % !set.test(15));
+
+        set.set(400);
+        expect(that % set.count() == 6);
+        expect(that % set.test(400));
+
+        index::ContextSet all;
+        for(std::uint32_t id = 0; id < 200; ++id) {
+            all.set(id);
+        }
+        index::ContextSet tail = all;
+        for(std::uint32_t id = 0; id < 190; ++id) {
+            tail.reset(id);
+        }
+        all &= tail;
+        expect(that % all.count() == 10);
+        expect(that % all.test(195));
+        expect(that % !all.test(0));
+    };
+
+    test("ManyContexts") = [] {
+        /// Each header context has a unique occurrence and a shared occurrence, so that
+        /// every one of them introduces a new canonical context.
+        for(std::uint32_t count: {1000u, 10000u}) {
+            HeaderIndex base;
+            for(std::uint32_t i = 0; i < count; ++i) {
+                RawIndex index;
+                index.add_occurrence({0, 1}, 1);
+                index.add_occurrence({i + 1, i + 2}, 2);
+                auto context = base.merge(std::format("test{}.h", i), 1, index);
+                expect(that % context.cctx_id == i);
+            }
+            expect(that % base.canonical_context_count() == count);
+
+            auto& shared = base.occurrences[{0, 1}][0];
+            expect(that % base.dependent_elem_states[shared.ctx.offset()].count() == count);
+
+            /// The same content reuses the existing canonical context.
+            RawIndex index;
+            index.add_occurrence({0, 1}, 1);
+            index.add_occurrence({count, count + 1}, 2);
+            auto context = base.merge("again.h", 1, index);
+            expect(that % context.cctx_id == count - 1);
+            expect(that % base.header_context_count() == count + 1);
+            expect(that % base.canonical_context_count() == count);
+
+            /// Removing the header erases its canonical context from element states.
+            base.remove("test0.h");
+            expect(that % base.canonical_context_count() == count - 1);
+            expect(that % base.dependent_elem_states[shared.ctx.offset()].count() == count - 1);
+            expect(that % !base.dependent_elem_states[shared.ctx.offset()].test(0));
+        }
+    };
 };
 
 #if 0
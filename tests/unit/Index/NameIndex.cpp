@@ -0,0 +1,72 @@
+#include "Test/Test.h"
+#include "Index/NameIndex.h"
+
+namespace clice::testing {
+
+namespace {
+
+using index::NameIndex;
+
+using Names = std::vector<std::string>;
+
+auto names = [](llvm::ArrayRef<NameIndex::Result> results) {
+    Names qualified_names;
+    for(auto& result: results) {
+        qualified_names.emplace_back(result.symbol->scope + result.symbol->name);
+    }
+    return qualified_names;
+};
+
+suite<"NameIndex"> name_index = [] {
+    test("Query") = [] {
+        NameIndex index;
+        index.update("vector.h",
+                     1,
+                     {
+                         {"vector",      "std::", SymbolKind::Class},
+                         {"vector_base", "std::", SymbolKind::Class},
+                         {"unique_ptr",  "std::", SymbolKind::Class},
+                     });
+        index.update("other.h", 1, {{"make_vector", "", SymbolKind::Function}});
+        expect(that % index.size() == 4);
+
+        /// Short query only matches the prefix.
+        auto results = index.query("ve", 0);
+        expect(that % names(results) == Names{"std::vector", "std::vector_base"});
+        expect(that % results[0].file == "vector.h");
+
+        results = index.query("vec", 0);
+        expect(that % results.size() == 3);
+        expect(that % results.back().symbol->name == "make_vector");
+
+        /// Abbreviated queries match the segment heads.
+        expect(that % names(index.query("u_p", 0)) == Names{"std::unique_ptr"});
+        expect(that % names(index.query("vb", 0)) == Names{"std::vector_base"});
+        expect(that % index.query("xyz", 0).empty());
+
+        /// Only the best results are kept.
+        expect(that % names(index.query("vec", 1)) == Names{"std::vector"});
+    };
+
+    test("Update") = [] {
+        NameIndex index;
+        index.update("foo.h", 1, {{"foo", "", SymbolKind::Function}});
+        index.update("foo.h", 1, {{"bar", "", SymbolKind::Function}});
+        expect(that % names(index.query("foo", 0)) == Names{"foo"});
+        expect(that % index.contains("foo.h", 1));
+        expect(that % !index.contains("foo.h", 2));
+
+        index.update("foo.h", 2, {{"bar", "", SymbolKind::Function}});
+        expect(that % index.query("foo", 0).empty());
+        expect(that % names(index.query("bar", 0)) == Names{"bar"});
+
+        index.remove("foo.h");
+        expect(that % index.size() == 0);
+        expect(that % !index.contains("foo.h", 2));
+        expect(that % index.query("bar", 0).empty());
+    };
+};
+
+}  // namespace
+
+}  // namespace clice::testing
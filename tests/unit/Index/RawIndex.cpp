@@ -0,0 +1,77 @@
+#include "Test/Tester.h"
+#include "Index/Index.h"
+
+namespace clice::testing {
+
+namespace {
+
+using namespace clice::index::memory;
+
+suite<"RawIndex"> raw_index = [] {
+    test("Build") = [] {
+        Tester tester;
+        tester.add_files("main.cpp", R"cpp(
+#[test.h]
+#define TWICE(x) x + x
+
+namespace ns {
+
+int foo(int x);
+
+}  // namespace ns
+
+#[main.cpp]
+#include "test.h"
+
+int bar() {
+    int sum = 0;
+    for(int i = 0; i < 10; ++i) {
+        sum += TWICE(ns::foo(i));
+        sum += TWICE(ns::foo(sum));
+    }
+    return sum;
+}
+)cpp");
+        expect(that % tester.compile());
+
+        auto indices = index::memory::index(*tester.unit);
+        auto& tu = *indices.tu_index;
+        expect(that % indices.header_indices.size() == 1);
+        auto& header = *indices.header_indices.begin()->second;
+
+        /// The symbols are filled from the declarations and macros.
+        bool found_foo = false;
+        bool found_macro = false;
+        for(auto& [id, symbol]: tu.symbols) {
+            if(symbol.name == "foo") {
+                found_foo = true;
+                expect(that % symbol.scope == "ns::");
+                expect(that % symbol.kind == SymbolKind::Function);
+            } else if(symbol.name == "TWICE") {
+                found_macro = true;
+                expect(that % symbol.kind == SymbolKind::Macro);
+            }
+        }
+        expect(that % found_foo);
+        expect(that % found_macro);
+
+        for(auto* index: {static_cast<RawIndex*>(&tu), &header}) {
+            expect(that % !index->symbols.empty());
+            expect(that % !index->occurrences.empty());
+
+            /// Occurrences of the same range and symbol are stored once.
+            for(auto& [range, occurrences]: index->occurrences) {
+                for(std::size_t i = 0; i < occurrences.size(); ++i) {
+                    for(std::size_t j = i + 1; j < occurrences.size(); ++j) {
+                        expect(that %
+                               occurrences[i].target_symbol != occurrences[j].target_symbol);
+                    }
+                }
+            }
+        }
+    };
+};
+
+}  // namespace
+
+}  // namespace clice::testing
@@ -0,0 +1,135 @@
+#include "Test/Tester.h"
+#include "Index/SymbolIndex.h"
+
+namespace clice::testing {
+
+namespace {
+
+suite<"SymbolIndex"> symbol_index = [] {
+    test("Locate") = [] {
+        Tester tester;
+        tester.add_files("main.cpp", R"cpp(
+#[test.h]
+int bar();
+
+#[main.cpp]
+#include "test.h"
+
+int @foo[foo]() {
+    return $(call)bar();
+}
+
+int x = fo$(use)o() + bar();
+)cpp");
+        tester.compile();
+        expect(that % tester.unit.has_value());
+
+        auto& unit = *tester.unit;
+        auto indices = index::SymbolIndex::build(unit, 42);
+        expect(that % indices.size() == 2);
+
+        auto& buffer = indices[unit.interested_file()];
+        index::SymbolIndex index(buffer.data(), buffer.size());
+        expect(that % index.path() == unit.file_path(unit.interested_file()));
+
+        /// The dependencies are recorded to decide whether the unit should be indexed again.
+        expect(that % index.arguments_hash() == 42);
+        expect(that % index.includes().length() == 1);
+        for(auto& [fid, header_buffer]: indices) {
+            if(fid != unit.interested_file()) {
+                index::SymbolIndex header(header_buffer.data(), header_buffer.size());
+                expect(that % header.includes().length() == 0);
+                expect(that % index.includes()[0].path() == header.path());
+                expect(that % index.includes()[0].hash() == header.hash());
+            }
+        }
+
+        /// Symbols are sorted by id.
+        auto symbols = index.symbols();
+        expect(that % symbols.length() > 0);
+        for(std::uint32_t i = 1; i < symbols.length(); ++i) {
+            expect(that % symbols[i - 1].hash() < symbols[i].hash());
+        }
+
+        /// Occurrences are sorted by range.
+        auto occurrences = index.occurrences();
+        for(std::uint32_t i = 1; i < occurrences.length(); ++i) {
+            expect(that % occurrences[i - 1].range().begin <= occurrences[i].range().begin);
+        }
+
+        auto located = index.locateSymbol(tester.point("use"));
+        expect(that % located.size() == 1);
+        expect(that % located[0].name() == "foo");
+
+        /// The definition of `foo` is recorded in its relations.
+        auto foo = index.locateSymbol(located[0].hash());
+        expect(that % foo.has_value());
+        expect(that % foo->name() == "foo");
+        bool defined = false;
+        for(auto relation: foo->relations()) {
+            if(relation.kind() == RelationKind::Definition) {
+                defined = relation.range().begin == tester.range("foo").begin;
+            }
+        }
+        expect(that % defined);
+
+        /// `bar` is only declared in the header, but referenced in main file.
+        located = index.locateSymbol(tester.point("call"));
+        expect(that % located.size() == 1);
+        expect(that % located[0].name() == "bar");
+
+        expect(that % index.locateSymbol(std::uint64_t(0)) == std::nullopt);
+        expect(that % index.locateSymbol(0u).empty());
+    };
+
+    test("Hierarchy") = [] {
+        Tester tester;
+        tester.add_files("main.cpp", R"cpp(
+#[main.cpp]
+struct $(base)Base {};
+
+struct $(derived)Derived : Base {};
+
+void $(callee)callee() {}
+
+void $(caller)caller() {
+    callee();
+}
+)cpp");
+        tester.compile();
+        expect(that % tester.unit.has_value());
+
+        auto& unit = *tester.unit;
+        auto indices = index::SymbolIndex::build(unit);
+        auto& buffer = indices[unit.interested_file()];
+        index::SymbolIndex index(buffer.data(), buffer.size());
+
+        auto hash = [&](llvm::StringRef name) {
+            auto located = index.locateSymbol(tester.point(name));
+            expect(that % located.size() == 1);
+            return located[0].hash();
+        };
+
+        /// Whether the symbol has a relation of `kind` whose target is `target`.
+        auto has_relation = [&](std::uint64_t symbol, RelationKind kind, std::uint64_t target) {
+            auto found = index.locateSymbol(symbol);
+            expect(that % found.has_value());
+            for(auto relation: found->relations()) {
+                if(relation.kind() == kind && relation.target_hash() == target) {
+                    return true;
+                }
+            }
+            return false;
+        };
+
+        /// Both directions are recorded, so the hierarchy could be expanded from either side.
+        expect(that % has_relation(hash("callee"), RelationKind::Caller, hash("caller")));
+        expect(that % has_relation(hash("caller"), RelationKind::Callee, hash("callee")));
+        expect(that % has_relation(hash("derived"), RelationKind::Base, hash("base")));
+        expect(that % has_relation(hash("base"), RelationKind::Derived, hash("derived")));
+    };
+};
+
+}  // namespace
+
+}  // namespace clice::testing
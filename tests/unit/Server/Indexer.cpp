@@ -0,0 +1,250 @@
+#include "Test/Tester.h"
+#include "Server/Indexer.h"
+#include "Support/Compare.h"
+#include "Support/FileSystem.h"
+
+namespace clice::testing {
+
+namespace {
+
+suite<"Indexer"> indexer = [] {
+    test("FeatureStore") = [] {
+        llvm::SmallString<128> directory;
+        expect(that % !llvm::sys::fs::createUniqueDirectory("clice", directory));
+
+        config::Config config;
+        config.project.index_dir = path::join(directory, "index");
+
+        Tester tester;
+        tester.add_main("main.cpp", R"cpp(
+namespace ns {
+
+struct Foo {
+    void bar() {
+        int x = 1;
+    }
+};
+
+}  // namespace ns
+)cpp");
+        expect(that % tester.compile());
+
+        auto& unit = *tester.unit;
+        Indexer indexer(tester.database, config);
+        async::run([&]() -> async::Task<bool> {
+            co_await indexer.index(unit);
+            co_return true;
+        }());
+
+        /// The stored features are the same with the built ones.
+        auto path = unit.file_path(unit.interested_file());
+        auto content = unit.interested_content();
+        auto index = indexer.load_features(path, content);
+        expect(that % index.has_value());
+        expect(that % index->path() == path);
+        expect(that % index->content() == content);
+
+        auto buffers = index::FeatureIndex::build(unit);
+        auto& buffer = buffers[unit.interested_file()];
+        index::FeatureIndex built(buffer.data(), buffer.size());
+        expect(that % !index->semanticTokens().empty());
+        expect(that % refl::equal(index->semanticTokens(), built.semanticTokens()));
+        expect(that % refl::equal(index->foldingRanges(), built.foldingRanges()));
+        expect(that % refl::equal(index->documentSymbols(), built.documentSymbols()));
+        expect(that % refl::equal(index->documentLinks(), built.documentLinks()));
+
+        /// The stored features are outdated if the content is changed.
+        expect(that % !indexer.load_features(path, content.str() + "\n").has_value());
+
+        /// A truncated file is rejected rather than read out of bounds.
+        std::error_code ec;
+        auto features = path::join(config.project.index_dir, "features");
+        for(fs::directory_iterator it(features, ec), end; it != end && !ec; it.increment(ec)) {
+            auto stored = fs::read(it->path());
+            expect(that % stored.has_value());
+            auto truncated = llvm::StringRef(*stored).take_front(stored->size() / 2);
+            expect(that % fs::write(it->path(), truncated).has_value());
+        }
+        expect(that % !ec);
+        expect(that % !indexer.load_features(path, content).has_value());
+
+        llvm::sys::fs::remove_directories(directory);
+    };
+
+    test("SymbolStore") = [] {
+        llvm::SmallString<128> directory;
+        expect(that % !llvm::sys::fs::createUniqueDirectory("clice", directory));
+
+        config::Config config;
+        config.project.index_dir = path::join(directory, "index");
+
+        Tester tester;
+        tester.add_main("main.cpp", R"cpp(
+int foo();
+
+int bar() {
+    return foo();
+}
+)cpp");
+        expect(that % tester.compile());
+
+        auto& unit = *tester.unit;
+        Indexer indexer(tester.database, config);
+        async::run([&]() -> async::Task<bool> {
+            co_await indexer.index(unit);
+            co_return true;
+        }());
+
+        auto path = unit.file_path(unit.interested_file());
+        auto index = indexer.load_symbols(path);
+        expect(that % index.has_value());
+        expect(that % index->path() == path);
+
+        /// A truncated file is rejected rather than read out of bounds.
+        std::error_code ec;
+        auto symbols = path::join(config.project.index_dir, "symbols");
+        for(fs::directory_iterator it(symbols, ec), end; it != end && !ec; it.increment(ec)) {
+            auto stored = fs::read(it->path());
+            expect(that % stored.has_value());
+            auto truncated = llvm::StringRef(*stored).take_front(stored->size() / 2);
+            expect(that % fs::write(it->path(), truncated).has_value());
+        }
+        expect(that % !ec);
+        expect(that % !indexer.load_symbols(path).has_value());
+
+        llvm::sys::fs::remove_directories(directory);
+    };
+
+    test("Merge") = [] {
+        llvm::SmallString<128> directory;
+        expect(that % !llvm::sys::fs::createUniqueDirectory("clice", directory));
+
+        config::Config config;
+        config.project.index_dir = path::join(directory, "index");
+        config.index.merge_threshold = 2;
+
+        CompilationDatabase database;
+        Indexer indexer(database, config);
+
+        std::string header;
+
+        /// The paths of units as they are stored in the header contexts.
+        llvm::StringMap<std::string> units;
+
+        auto index = [&](llvm::StringRef file, llvm::StringRef content) {
+            Tester tester;
+            tester.add_main(file, content);
+            tester.add_file("test.h", R"cpp(
+#ifdef VALUE
+int value = VALUE;
+#endif
+int shared;
+)cpp");
+            expect(that % tester.compile());
+
+            auto& unit = *tester.unit;
+            header = unit.file_path(unit.file_id(path::join(".", "test.h")));
+            units[file] = unit.file_path(unit.interested_file());
+            async::run([&]() -> async::Task<bool> {
+                co_await indexer.index(unit);
+                co_return true;
+            }());
+        };
+
+        auto contexts = [&](llvm::StringRef file) {
+            auto merged = indexer.merged_index(header);
+            return merged ? merged->header_contexts.lookup(units.lookup(file)).size() : 0;
+        };
+
+        index("a.cpp", "#include \"test.h\"\n");
+        expect(that % indexer.unmerged_indices() == 1);
+        expect(that % indexer.unmerged_indices(header) == 1);
+        expect(that % indexer.merged_index(header) == nullptr);
+
+        /// The threshold is reached, all raw indices are merged and freed.
+        index("b.cpp", "#define VALUE 2\n#include \"test.h\"\n");
+        expect(that % indexer.unmerged_indices() == 0);
+        expect(that % indexer.unmerged_indices(header) == 0);
+        expect(that % indexer.merged_index(header) != nullptr);
+        expect(that % contexts("a.cpp") == 1);
+        expect(that % contexts("b.cpp") == 1);
+
+        /// The unmerged index from the last indexing of a unit is replaced.
+        index("a.cpp", "#define VALUE 3\n#include \"test.h\"\n");
+        expect(that % indexer.unmerged_indices() == 1);
+        index("a.cpp", "#define VALUE 4\n#include \"test.h\"\n");
+        expect(that % indexer.unmerged_indices() == 1);
+        expect(that % indexer.unmerged_indices(header) == 1);
+
+        /// Merging a unit again removes its old contexts.
+        index("c.cpp", "#include \"test.h\"\n");
+        expect(that % indexer.unmerged_indices() == 0);
+        expect(that % contexts("a.cpp") == 1);
+        expect(that % contexts("b.cpp") == 1);
+        expect(that % contexts("c.cpp") == 1);
+        expect(that % indexer.merged_index(header)->header_contexts.size() == 3);
+
+        llvm::sys::fs::remove_directories(directory);
+    };
+
+    test("MergeShards") = [] {
+        llvm::SmallString<128> directory;
+        expect(that % !llvm::sys::fs::createUniqueDirectory("clice", directory));
+
+        config::Config config;
+        config.project.index_dir = path::join(directory, "index");
+        config.index.merge_threshold = 6;
+        config.index.concurrency = 2;
+
+        CompilationDatabase database;
+        Indexer indexer(database, config);
+
+        /// Each unit includes three headers, every header is merged by its own shard and
+        /// the shards are more than the concurrency.
+        llvm::SmallVector<std::string> headers;
+        llvm::StringMap<std::string> units;
+        auto index = [&](llvm::StringRef file) {
+            Tester tester;
+            tester.add_main(file, "#include \"x.h\"\n#include \"y.h\"\n#include \"z.h\"\n");
+            tester.add_file("x.h", "int x;\n");
+            tester.add_file("y.h", "int y;\n");
+            tester.add_file("z.h", "int z;\n");
+            expect(that % tester.compile());
+
+            auto& unit = *tester.unit;
+            headers.clear();
+            for(auto name: {"x.h", "y.h", "z.h"}) {
+                headers.emplace_back(unit.file_path(unit.file_id(path::join(".", name))));
+            }
+            units[file] = unit.file_path(unit.interested_file());
+            async::run([&]() -> async::Task<bool> {
+                co_await indexer.index(unit);
+                co_return true;
+            }());
+        };
+
+        index("a.cpp");
+        expect(that % indexer.unmerged_indices() == 3);
+        for(auto& header: headers) {
+            expect(that % indexer.merged_index(header) == nullptr);
+        }
+
+        /// All shards are merged and published together.
+        index("b.cpp");
+        expect(that % indexer.unmerged_indices() == 0);
+        for(auto& header: headers) {
+            auto merged = indexer.merged_index(header);
+            expect(that % merged != nullptr);
+            expect(that % indexer.unmerged_indices(header) == 0);
+            expect(that % merged->header_contexts.size() == 2);
+            expect(that % merged->header_contexts.lookup(units.lookup("a.cpp")).size() == 1);
+            expect(that % merged->header_contexts.lookup(units.lookup("b.cpp")).size() == 1);
+        }
+
+        llvm::sys::fs::remove_directories(directory);
+    };
+};
+
+}  // namespace
+
+}  // namespace clice::testing
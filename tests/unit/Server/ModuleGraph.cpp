@@ -0,0 +1,61 @@
+#include "Test/Test.h"
+#include "Server/ModuleGraph.h"
+#include "Support/FileSystem.h"
+
+namespace clice::testing {
+
+namespace {
+
+suite<"ModuleGraph"> module_graph = [] {
+    test("CacheRoundTrip") = [] {
+        llvm::SmallString<128> directory;
+        expect(that % !llvm::sys::fs::createUniqueDirectory("clice", directory));
+
+        auto file = path::join(directory, "a.cppm");
+        expect(that % fs::write(file, "export module A;\nimport B;\nimport :C;\n").has_value());
+
+        CompilationDatabase database;
+        database.update_command(directory, file, llvm::StringRef("clang++ -std=c++20 a.cppm"));
+
+        config::Config config;
+        config.project.cache_dir = path::join(directory, "cache");
+
+        ModuleGraph graph(database, config);
+        async::run([&]() -> async::Task<bool> {
+            co_await graph.scan();
+            co_return true;
+        }());
+        graph.save();
+
+        auto scanned = graph.scan_result(file);
+        expect(that % scanned != nullptr);
+
+        ModuleGraph loaded(database, config);
+        loaded.load();
+
+        auto result = loaded.scan_result(file);
+        expect(that % result != nullptr);
+        expect(that % result->info.isInterfaceUnit);
+        expect(that % result->info.name == "A");
+        expect(that % (result->info.mods == std::vector<std::string>{"B", "A:C"}));
+        expect(that % result->hash == scanned->hash);
+        expect(that % result->mtime == scanned->mtime);
+        expect(that % result->arguments == 0);
+
+        /// A truncated file is rejected rather than read out of bounds.
+        auto cache = path::join(config.project.cache_dir, "modules.bin");
+        auto content = fs::read(cache);
+        expect(that % content.has_value());
+        expect(that % fs::write(cache, llvm::StringRef(*content).drop_back(8)).has_value());
+
+        ModuleGraph broken(database, config);
+        broken.load();
+        expect(that % broken.scan_result(file) == nullptr);
+
+        llvm::sys::fs::remove_directories(directory);
+    };
+};
+
+}  // namespace
+
+}  // namespace clice::testing
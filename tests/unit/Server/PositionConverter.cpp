@@ -0,0 +1,45 @@
+#include "Test/Test.h"
+#include "Server/Convert.h"
+
+namespace clice::testing {
+
+namespace {
+
+suite<"PositionConverter"> position_converter = [] {
+    test("RandomAccess") = [] {
+        PositionConverter converter("int x;\nint y;", PositionEncodingKind::UTF16);
+
+        /// Offsets are converted in any order.
+        expect(that % converter.toPosition(11) == proto::Position{1, 4});
+        expect(that % converter.toPosition(4) == proto::Position{0, 4});
+        expect(that % converter.toPosition(13) == proto::Position{1, 6});
+        expect(that % converter.toPosition(0) == proto::Position{0, 0});
+        expect(that % converter.to_offset({1, 4}) == 11);
+    };
+
+    test("Encoding") = [] {
+        /// "你" takes 3 bytes in UTF-8, 1 code unit in UTF-16 and "😀" takes 4 bytes
+        /// in UTF-8, 2 code units in UTF-16.
+        llvm::StringRef content = "int x;\nauto s = \"你😀\"; int y;";
+        auto offset = content.find("int y");
+
+        PositionConverter utf8(content, PositionEncodingKind::UTF8);
+        expect(that % utf8.toPosition(offset) == proto::Position{1, 20});
+        expect(that % utf8.to_offset({1, 20}) == offset);
+
+        PositionConverter utf16(content, PositionEncodingKind::UTF16);
+        expect(that % utf16.toPosition(offset) == proto::Position{1, 16});
+        expect(that % utf16.to_offset({1, 16}) == offset);
+
+        PositionConverter utf32(content, PositionEncodingKind::UTF32);
+        expect(that % utf32.toPosition(offset) == proto::Position{1, 15});
+        expect(that % utf32.to_offset({1, 15}) == offset);
+
+        /// The ASCII lines are not affected.
+        expect(that % utf16.toPosition(4) == proto::Position{0, 4});
+    };
+};
+
+}  // namespace
+
+}  // namespace clice::testing
@@ -0,0 +1,75 @@
+#include "Test/Test.h"
+#include "Server/Convert.h"
+
+namespace clice::testing {
+
+namespace {
+
+using Data = std::vector<proto::uinteger>;
+
+suite<"SemanticTokens"> semantic_tokens = [] {
+    using Tokens = std::vector<feature::SemanticToken>;
+
+    llvm::StringRef content = "  abc  d\nwxyz\n    ef\n g\n";
+    PositionConverter converter(content, PositionEncodingKind::UTF8);
+
+    auto token = [](std::uint32_t begin, std::uint32_t end, SymbolKind kind = SymbolKind::Number) {
+        return feature::SemanticToken{
+            .range = {begin, end},
+            .kind = kind,
+            .modifiers = {},
+        };
+    };
+
+    auto encode = [&](const Tokens& tokens) {
+        return proto::to_semantic_tokens(converter, tokens);
+    };
+
+    /// line 0: (0, 2) (0, 7), line 2: (2, 4), line 3: (3, 1)
+    Data data = encode({token(2, 5), token(7, 8), token(18, 20), token(22, 23)});
+
+    test("Encode") = [&] {
+        expect(that % data == Data{0, 2, 3, 1, 0, 0, 5, 1, 1, 0, 2, 4, 2, 1, 0, 1, 1, 1, 1, 0});
+    };
+
+    test("Slice") = [&] {
+        /// The first selected token is relative to the document start.
+        expect(that % proto::slice_semantic_tokens(data, 2, 2) == Data{2, 4, 2, 1, 0});
+        expect(that % proto::slice_semantic_tokens(data, 1, 3) ==
+               Data{2, 4, 2, 1, 0, 1, 1, 1, 1, 0});
+        expect(that % proto::slice_semantic_tokens(data, 0, 0) ==
+               Data{0, 2, 3, 1, 0, 0, 5, 1, 1, 0});
+        expect(that % proto::slice_semantic_tokens(data, 4, 10).empty());
+    };
+
+    test("Diff") = [&] {
+        auto edit = proto::diff_semantic_tokens(data, data);
+        expect(that % edit.start == 20);
+        expect(that % edit.deleteCount == 0);
+        expect(that % edit.data.empty());
+
+        /// Remove the token in line 2, the line delta of the token in line 3 becomes 3.
+        Data removed = encode({token(2, 5), token(7, 8), token(22, 23)});
+        expect(that % removed == Data{0, 2, 3, 1, 0, 0, 5, 1, 1, 0, 3, 1, 1, 1, 0});
+
+        edit = proto::diff_semantic_tokens(data, removed);
+        expect(that % edit.start == 10);
+        expect(that % edit.deleteCount == 6);
+        expect(that % edit.data == Data{3});
+
+        /// Insert a token to line 1, only the changed integers are replaced.
+        Data inserted = encode({token(2, 5),
+                                token(7, 8),
+                                token(9, 13, SymbolKind::Character),
+                                token(18, 20),
+                                token(22, 23)});
+        edit = proto::diff_semantic_tokens(data, inserted);
+        expect(that % edit.start == 10);
+        expect(that % edit.deleteCount == 1);
+        expect(that % edit.data == Data{1, 0, 4, 2, 0, 1});
+    };
+};
+
+}  // namespace
+
+}  // namespace clice::testing
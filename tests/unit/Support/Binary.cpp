@@ -206,6 +206,25 @@ suite<"Binary"> binary = [] {
         auto node2 = binary::deserialize(proxy);
         expect(that % refl::equal(node, node2));
     };
+
+    test("Validate") = [&] {
+        Node node = {
+            1,
+            {{2}, {3, {{4}}}},
+        };
+
+        auto [buffer, proxy] = binary::serialize(node);
+        expect(that % binary::validate(proxy, buffer.size()));
+
+        /// The nested arrays are out of the truncated data.
+        expect(that % !binary::validate(proxy, sizeof(binary::binarify_t<Node>)));
+        expect(that % !binary::validate(proxy, buffer.size() - 1));
+
+        std::vector<std::string> strings = {"a", "bc"};
+        auto [buffer2, proxy2] = binary::serialize(strings);
+        expect(that % binary::validate(proxy2, buffer2.size()));
+        expect(that % !binary::validate(proxy2, buffer2.size() - 1));
+    };
 };
 
 }  // namespace
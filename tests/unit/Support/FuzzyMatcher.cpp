@@ -0,0 +1,34 @@
+#include "Test/Test.h"
+#include "Support/FuzzyMatcher.h"
+
+namespace clice::testing {
+
+namespace {
+
+suite<"FuzzyMatcher"> fuzzy_matcher = [] {
+    test("Match") = [] {
+        FuzzyMatcher matcher("u_p");
+        expect(that % matcher.match("unique_ptr").has_value());
+        expect(that % !matcher.match("upper").has_value());
+
+        /// Longer lowercased words go through the vectorized path.
+        FuzzyMatcher long_matcher("getvalue");
+        expect(that % long_matcher.match("GET_VALUE_OF_THE_LONG_NAME").has_value());
+        expect(that % !long_matcher.match("GET_VALIDATOR_OF_THE_LONG_NAME").has_value());
+    };
+
+    test("CharSet") = [] {
+        FuzzyMatcher matcher("Vec_2");
+        expect(that % matcher.may_match(FuzzyMatcher::char_set("my_vector2")));
+        expect(that % matcher.may_match(FuzzyMatcher::char_set("VEC_2")));
+        expect(that % !matcher.may_match(FuzzyMatcher::char_set("vector2")));
+        expect(that % !matcher.may_match(FuzzyMatcher::char_set("my_vector")));
+
+        FuzzyMatcher empty("");
+        expect(that % empty.may_match(FuzzyMatcher::char_set("")));
+    };
+};
+
+}  // namespace
+
+}  // namespace clice::testing
@@ -0,0 +1,100 @@
+#include "Test/Test.h"
+#include "Support/LineTable.h"
+
+namespace clice::testing {
+
+namespace {
+
+suite<"LineTable"> line_table = [] {
+    test("Empty") = [] {
+        LineTable table("");
+        expect(that % table.size() == 1);
+        expect(that % table.line(0) == 0);
+    };
+
+    test("Position") = [] {
+        llvm::StringRef content = "int x;\n\nint y;\nint z;";
+        LineTable table(content);
+        expect(that % table.size() == 4);
+        expect(that % table.line_start(1) == 7);
+        expect(that % table.line_start(2) == 8);
+        expect(that % table.line_start(3) == 15);
+
+        auto [line, column] = table.position(content.find("x"));
+        expect(that % line == 0);
+        expect(that % column == 4);
+
+        /// The newline character belongs to the line it ends.
+        std::tie(line, column) = table.position(6);
+        expect(that % line == 0);
+        expect(that % column == 6);
+
+        std::tie(line, column) = table.position(content.find("z"));
+        expect(that % line == 3);
+        expect(that % column == 4);
+
+        /// The end of content.
+        std::tie(line, column) = table.position(content.size());
+        expect(that % line == 3);
+        expect(that % column == 6);
+    };
+
+    test("TrailingNewline") = [] {
+        LineTable table("a\n");
+        expect(that % table.size() == 2);
+        expect(that % table.line(2) == 1);
+    };
+
+    test("LineContent") = [] {
+        LineTable table("int x;\n\nint y;\n");
+        expect(that % table.is_ascii());
+        expect(that % table.size() == 4);
+        expect(that % table.line_content(0) == "int x;");
+        expect(that % table.line_content(1) == "");
+        expect(that % table.line_content(2) == "int y;");
+        expect(that % table.line_content(3) == "");
+    };
+
+    test("Encoding") = [] {
+        /// "你" takes 3 bytes in UTF-8, 1 code unit in UTF-16 and "😀" takes 4 bytes
+        /// in UTF-8, 2 code units in UTF-16.
+        llvm::StringRef content = "int x;\nauto s = \"你😀\"; int y;";
+        LineTable table(content);
+        expect(that % !table.is_ascii());
+
+        using Position = std::pair<std::uint32_t, std::uint32_t>;
+        auto offset = content.find("int y");
+        auto position = table.to_position(offset, PositionEncodingKind::UTF8);
+        expect(that % position == Position{1, 20});
+        expect(that % table.to_offset(1, 20, PositionEncodingKind::UTF8) == offset);
+
+        position = table.to_position(offset, PositionEncodingKind::UTF16);
+        expect(that % position == Position{1, 16});
+        expect(that % table.to_offset(1, 16, PositionEncodingKind::UTF16) == offset);
+
+        position = table.to_position(offset, PositionEncodingKind::UTF32);
+        expect(that % position == Position{1, 15});
+        expect(that % table.to_offset(1, 15, PositionEncodingKind::UTF32) == offset);
+
+        /// The ASCII lines are not affected.
+        expect(that % table.to_position(4, PositionEncodingKind::UTF16) == Position{0, 4});
+        expect(that % table.to_offset(0, 4, PositionEncodingKind::UTF16) == 4);
+    };
+
+    test("Clamp") = [] {
+        llvm::StringRef content = "int x;\nauto s = \"你\";";
+        LineTable table(content);
+
+        /// The column past the end of line maps to the end of line.
+        expect(that % table.to_offset(0, 100, PositionEncodingKind::UTF8) == 6);
+        expect(that % table.to_offset(1, 100, PositionEncodingKind::UTF16) == content.size());
+
+        /// The line past the last one maps to the end of text.
+        expect(that % table.to_offset(2, 0, PositionEncodingKind::UTF8) == content.size());
+        expect(that % table.to_offset(100, 3, PositionEncodingKind::UTF16) == content.size());
+    };
+};
+
+}  // namespace
+
+}  // namespace clice::testing